@@ -21,6 +21,23 @@ public:
     virtual unsigned long get_period() const = 0;
     virtual unsigned long get_deadline() const = 0;
     virtual unsigned long get_hyperperiod() const = 0;
+    virtual int get_max_inflight_instances() const = 0;
+    virtual int get_edge_pool_slots() const = 0;
+    virtual const char *get_numa_placement() const = 0;
+    virtual const char *get_huge_pages() const = 0;
+    virtual bool get_lock_memory() const = 0;
+    virtual int get_stack_size_kb() const = 0;
+    virtual int get_warmup_activations() const = 0;
+    virtual const char *get_results_format() const = 0;
+    virtual bool get_live_metrics() const = 0;
+    virtual bool get_timeline() const = 0;
+    virtual const char *get_ftrace() const = 0;
+    virtual bool get_ftrace_snapshot() const = 0;
+    virtual const char *get_tracefs_path() const = 0;
+    virtual int get_stream_window() const = 0;
+    virtual int get_stream_interval_s() const = 0;
+    virtual bool get_exec_feedback() const = 0;
+    virtual double get_exec_feedback_tolerance() const = 0;
     virtual const char *get_tasks_name(unsigned t) const = 0;
     virtual const char *get_tasks_type(unsigned t) const = 0;
 #if RTDAG_FRED_SUPPORT == ON
@@ -37,6 +54,9 @@ public:
     virtual unsigned int get_matrix_size(unsigned t) const = 0;
     virtual unsigned int get_omp_target(unsigned t) const = 0;
     virtual float get_ticks_per_us(unsigned t) const = 0;
+
+    virtual const char *get_tasks_wait_policy(unsigned t) const = 0;
+    virtual unsigned long get_wait_spin_us() const = 0;
 };
 
 static inline void dump(const input_base &in) {
@@ -50,6 +70,23 @@ static inline void dump(const input_base &in) {
     std::printf("repetitions:   %u\n", in.get_repetitions());
     std::printf("period:        %lu\n", in.get_period());
     std::printf("deadline:      %lu\n", in.get_deadline());
+    std::printf("max_inflight:  %d\n", in.get_max_inflight_instances());
+    std::printf("pool_slots:    %d\n", in.get_edge_pool_slots());
+    std::printf("numa:          %s\n", in.get_numa_placement());
+    std::printf("huge_pages:    %s\n", in.get_huge_pages());
+    std::printf("lock_memory:   %d\n", in.get_lock_memory());
+    std::printf("stack_size_kb: %d\n", in.get_stack_size_kb());
+    std::printf("warmup:        %d\n", in.get_warmup_activations());
+    std::printf("results:       %s\n", in.get_results_format());
+    std::printf("live_metrics:  %d\n", in.get_live_metrics());
+    std::printf("timeline:      %d\n", in.get_timeline());
+    std::printf("ftrace:        %s%s (%s)\n", in.get_ftrace(),
+                in.get_ftrace_snapshot() ? " + snapshot" : "",
+                in.get_tracefs_path());
+    std::printf("stream:        window %d, interval %d s\n",
+                in.get_stream_window(), in.get_stream_interval_s());
+    std::printf("exec_feedback: %d (tolerance %g%%)\n", in.get_exec_feedback(),
+                in.get_exec_feedback_tolerance());
     std::printf("\n");
     std::printf("tasks:\n");
     for (int i = 0, n_tasks = in.get_n_tasks(); i < n_tasks; ++i) {
@@ -108,6 +108,25 @@ input_yaml::input_yaml(const char *fname) : input_base() {
     GET_ATTR_REQ(dag_period, "dag_period");
     GET_ATTR_REQ(dag_deadline, "dag_deadline");
 
+    GET_ATTR_OPT(wait_spin_us, "wait_spin_us", 20);
+    GET_ATTR_OPT(max_inflight_instances, "max_inflight_instances", 1);
+    GET_ATTR_OPT(edge_pool_slots, "edge_pool_slots", 0);
+    GET_ATTR_OPT(numa_placement, "numa_placement", "consumer");
+    GET_ATTR_OPT(huge_pages, "huge_pages", "none");
+    GET_ATTR_OPT(lock_memory, "lock_memory", true);
+    GET_ATTR_OPT(stack_size_kb, "stack_size_kb", 0);
+    GET_ATTR_OPT(warmup_activations, "warmup_activations", 0);
+    GET_ATTR_OPT(results_format, "results_format", "text");
+    GET_ATTR_OPT(live_metrics, "live_metrics", true);
+    GET_ATTR_OPT(timeline, "timeline", false);
+    GET_ATTR_OPT(ftrace, "ftrace", "none");
+    GET_ATTR_OPT(ftrace_snapshot, "ftrace_snapshot", false);
+    GET_ATTR_OPT(tracefs_path, "tracefs_path", "/sys/kernel/tracing");
+    GET_ATTR_OPT(stream_window, "stream_window", 1000);
+    GET_ATTR_OPT(stream_interval_s, "stream_interval_s", 10);
+    GET_ATTR_OPT(exec_feedback, "exec_feedback", false);
+    GET_ATTR_OPT(exec_feedback_tolerance, "exec_feedback_tolerance", 1.0);
+
     GET_ATTR_REQ(n_tasks, "n_tasks");
     if (n_tasks < 1) {
         std::fprintf(stderr, "ERROR: negative value in 'n_tasks'\n");
@@ -133,6 +152,7 @@ input_yaml::input_yaml(const char *fname) : input_base() {
     std::vector<int> task_matrix_size;
     std::vector<float> task_ticks_us;
     std::vector<float> task_ewr;
+    std::vector<std::string> task_wait_policy;
 
     // Optional per-task attributes:
     std::vector<int> task_omp_target;
@@ -142,6 +162,7 @@ input_yaml::input_yaml(const char *fname) : input_base() {
     std::vector<float> task_ticks_us_default(n_tasks, -1);
     std::vector<int> task_prios_default(n_tasks, 0);
     std::vector<float> task_ewr_default(n_tasks, 1);
+    std::vector<std::string> task_wait_policy_default(n_tasks, "block");
 
     GET_VECT_REQ(task_names, "tasks_name");
     GET_VECT_REQ(task_types, "tasks_type");
@@ -164,6 +185,8 @@ input_yaml::input_yaml(const char *fname) : input_base() {
     GET_VECT_OPT(task_ewr, "tasks_expected_wcet_ratio", task_ewr_default);
 
     GET_VECT_OPT(task_prios, "tasks_prio", task_prios_default);
+    GET_VECT_OPT(task_wait_policy, "tasks_wait_policy",
+                 task_wait_policy_default);
 
     // Check in both directions
     exact_length<yaml_error_type::YAML_ERROR>(n_tasks, adj_mat.size(),
@@ -193,6 +216,7 @@ input_yaml::input_yaml(const char *fname) : input_base() {
             .omp_target = task_omp_target[i],
             .ticks_per_us = task_ticks_us[i],
             .expected_wcet_ratio = task_ewr[i],
+            .wait_policy = task_wait_policy[i],
 
 #if RTDAG_FRED_SUPPORT == ON
             .fred_id = fred_ids[i],
@@ -28,7 +28,7 @@ private:
     // YAML Structure:
     //
     // hyperperiod: long # in us
-    // repetitions: int
+    // repetitions: int # 0 to stream until SIGINT or SIGTERM
     //
     // n_cpus: int
     // cpus_freq: int[] # in MHz
@@ -41,6 +41,23 @@ private:
     //
     // dag_period: long # in us
     // dag_deadline: long # in us
+    // max_inflight_instances: int # 1 by default, no pipelining
+    // edge_pool_slots: int # zero-copy slots per edge, 0 for the default
+    // numa_placement: std::string # none, consumer (default), producer
+    // huge_pages: std::string # none (default), thp, hugetlb
+    // lock_memory: bool # mlockall() in each task, true by default
+    // stack_size_kb: int # stack of each task, 0 (default) for the default
+    // warmup_activations: int # not measured, 0 by default
+    // results_format: std::string # text (default), binary
+    // live_metrics: bool # publish counters for rtdag-top, true by default
+    // timeline: bool # save a Chrome/Perfetto trace, false by default
+    // ftrace: std::string # none (default), markers, window
+    // ftrace_snapshot: bool # snapshot the trace on deadline misses
+    // tracefs_path: std::string # /sys/kernel/tracing by default
+    // stream_window: int # activations kept when streaming, 1000 by default
+    // stream_interval_s: int # summary interval when streaming, 10 by default
+    // exec_feedback: bool # adjust ticks to the CPU time of each job
+    // exec_feedback_tolerance: double # in %, 1 by default
     //
     // n_tasks: int
     // tasks_name: std::string[], one per task
@@ -50,6 +67,9 @@ private:
     // tasks_rel_deadline: long[] # in us
     // tasks_affinity: int[]
     // fred_id: int[] # -1 if no fred id
+    // tasks_wait_policy: std::string[] # block, spin, spin_block, yield
+    //                                    # (all but block need futex queues)
+    // wait_spin_us: long # in us, busy-wait time of the spin_block policy
     //
     // # NOTE: there are other attributes not represented in this comment now!
     //
@@ -78,6 +98,25 @@ private:
     long long dag_period;
     long long dag_deadline;
 
+    long long wait_spin_us;
+    int max_inflight_instances;
+    int edge_pool_slots;
+    std::string numa_placement;
+    std::string huge_pages;
+    bool lock_memory;
+    int stack_size_kb;
+    int warmup_activations;
+    std::string results_format;
+    bool live_metrics;
+    bool timeline;
+    std::string ftrace;
+    bool ftrace_snapshot;
+    std::string tracefs_path;
+    int stream_window;
+    int stream_interval_s;
+    bool exec_feedback;
+    double exec_feedback_tolerance;
+
     // ------------------- TASKS DATA --------------------
 
     struct task_data {
@@ -92,6 +131,7 @@ private:
         int omp_target = 0;
         float ticks_per_us = -1;
         float expected_wcet_ratio = 1;
+        std::string wait_policy;
 #if RTDAG_FRED_SUPPORT == ON
         int fred_id;
 #endif
@@ -153,6 +193,75 @@ public:
     unsigned long get_hyperperiod() const override {
         return hyperperiod;
     }
+
+    int get_max_inflight_instances() const override {
+        return max_inflight_instances;
+    }
+
+    int get_edge_pool_slots() const override {
+        return edge_pool_slots;
+    }
+
+    const char *get_numa_placement() const override {
+        return numa_placement.c_str();
+    }
+
+    const char *get_huge_pages() const override {
+        return huge_pages.c_str();
+    }
+
+    bool get_lock_memory() const override {
+        return lock_memory;
+    }
+
+    int get_stack_size_kb() const override {
+        return stack_size_kb;
+    }
+
+    int get_warmup_activations() const override {
+        return warmup_activations;
+    }
+
+    const char *get_results_format() const override {
+        return results_format.c_str();
+    }
+
+    bool get_live_metrics() const override {
+        return live_metrics;
+    }
+
+    bool get_timeline() const override {
+        return timeline;
+    }
+
+    const char *get_ftrace() const override {
+        return ftrace.c_str();
+    }
+
+    bool get_ftrace_snapshot() const override {
+        return ftrace_snapshot;
+    }
+
+    const char *get_tracefs_path() const override {
+        return tracefs_path.c_str();
+    }
+
+    int get_stream_window() const override {
+        return stream_window;
+    }
+
+    int get_stream_interval_s() const override {
+        return stream_interval_s;
+    }
+
+    bool get_exec_feedback() const override {
+        return exec_feedback;
+    }
+
+    double get_exec_feedback_tolerance() const override {
+        return exec_feedback_tolerance;
+    }
+
     const char *get_tasks_name(unsigned t) const override {
         return tasks[t].name.c_str();
     }
@@ -203,10 +312,17 @@ public:
     }
 
     float get_ticks_per_us(unsigned t) const override {
-        float v = tasks[t].ticks_per_us;
-        // Return global variable if value is not supplied (basically if
-        // the value is positive it overrides the global variable)
-        return v > 0 ? v : ticks_per_us;
+        // Not positive if not supplied, the task then uses the calibration
+        // database or the global TICKS_PER_US
+        return tasks[t].ticks_per_us;
+    }
+
+    const char *get_tasks_wait_policy(unsigned t) const override {
+        return tasks[t].wait_policy.c_str();
+    }
+
+    unsigned long get_wait_spin_us() const override {
+        return wait_spin_us;
     }
 
 public:
@@ -0,0 +1,136 @@
+#include "newstuff/arena.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logging.h"
+#include "newstuff/numa.h"
+
+SharedArena::SharedArena(const std::string &name, size_t size,
+                         huge_pages backing) :
+    capacity(size),
+    backing(backing),
+    owner(getpid()) {
+    void *addr;
+
+#if RTDAG_TASK_IMPL == TASK_IMPL_PROCESS
+    if (backing == huge_pages::HUGETLB) {
+        (void)name;
+        addr = map_pages(capacity, backing, true);
+    } else {
+        addr = map_shm(name);
+    }
+#else
+    (void)name;
+    addr = map_pages(capacity, backing, false);
+#endif
+
+    if (addr == nullptr) {
+        LOG(ERROR, "could not map the DAG arena (%lu bytes): %s\n", capacity,
+            std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+
+    base = static_cast<u8 *>(addr);
+}
+
+#if RTDAG_TASK_IMPL == TASK_IMPL_PROCESS
+void *SharedArena::map_shm(const std::string &name) {
+    shm_name = "/rtdag-" + name + "-" + std::to_string(owner);
+
+    int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        LOG(ERROR, "shm_open(%s) failed: %s\n", shm_name.c_str(),
+            std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (ftruncate(fd, capacity) < 0) {
+        LOG(ERROR, "ftruncate(%s) failed: %s\n", shm_name.c_str(),
+            std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+
+    void *addr =
+        mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED) {
+        return nullptr;
+    }
+
+    // Honored only if shmem_enabled allows it
+    if (backing == huge_pages::THP) {
+        advise_huge_pages(addr, capacity);
+    }
+
+    return addr;
+}
+#endif
+
+SharedArena::~SharedArena() {
+    if (getpid() != owner) {
+        return;
+    }
+
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+        (*it)();
+    }
+
+    munmap(base, capacity);
+
+    if (!shm_name.empty()) {
+        shm_unlink(shm_name.c_str());
+    }
+}
+
+void *SharedArena::allocate(size_t size, size_t align) {
+    size_t offset = (used + align - 1) / align * align;
+    if (offset + size > capacity) {
+        throw std::logic_error("Exceeded the size of the DAG arena!");
+    }
+
+    used = offset + size;
+    return base + offset;
+}
+
+void SharedArena::prefault() {
+    ::prefault(base, used);
+}
+
+void SharedArena::close_region() {
+    if (region_node < 0 || used == region_begin) {
+        return;
+    }
+
+    // The rest of the last page belongs to this region as well
+    const size_t page = page_size(backing);
+    used = (used + page - 1) / page * page;
+    if (used > capacity) {
+        throw std::logic_error("Exceeded the size of the DAG arena!");
+    }
+
+    numa_bind(base + region_begin, used - region_begin, region_node);
+}
+
+void SharedArena::set_node(int node) {
+    if (node == region_node) {
+        return;
+    }
+
+    close_region();
+
+    if (node >= 0) {
+        const size_t page = page_size(backing);
+        used = (used + page - 1) / page * page;
+    }
+
+    region_begin = used;
+    region_node = node;
+}
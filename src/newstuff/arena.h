@@ -0,0 +1,127 @@
+#ifndef RTDAG_ARENA_H
+#define RTDAG_ARENA_H
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "newstuff/cacheline.h"
+#include "newstuff/hugepages.h"
+#include "newstuff/integers.h"
+
+// A single memory region, allocated up front, holding all the data that
+// tasks exchange during the DAG execution (queues, edge buffers, start
+// times, etc.).
+//
+// When tasks are processes the region is a POSIX shared memory segment,
+// mapped BEFORE forking, so that every pointer into the arena is valid in
+// all the tasks. When tasks are threads it is just an anonymous mapping.
+//
+// Allocation is a simple bump pointer, nothing is ever freed before the
+// whole arena is destroyed.
+//
+// The arena can be backed by huge pages: explicit huge pages are mapped as
+// shared anonymous memory instead of a named segment, which works just as
+// well since the arena is always mapped before forking.
+class SharedArena {
+    std::string shm_name;
+    u8 *base = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+    const huge_pages backing;
+
+    // Only the process that created the arena destroys the objects in it
+    // and unlinks the shared memory segment
+    pid_t owner;
+
+    std::vector<std::function<void()>> destructors;
+
+    // The NUMA node the memory allocated since region_begin is bound to
+    int region_node = -1;
+    size_t region_begin = 0;
+
+    void close_region();
+
+#if RTDAG_TASK_IMPL == TASK_IMPL_PROCESS
+    // Maps a new POSIX shared memory segment
+    void *map_shm(const std::string &name);
+#endif
+
+public:
+    // The size must be a multiple of page_size(backing)
+    SharedArena(const std::string &name, size_t size,
+                huge_pages backing = huge_pages::NONE);
+    ~SharedArena();
+
+    SharedArena(const SharedArena &) = delete;
+    SharedArena &operator=(const SharedArena &) = delete;
+
+    // Returns uninitialized memory from the arena
+    void *allocate(size_t size, size_t align);
+
+    // Touches all the memory allocated so far, so that tasks never take a
+    // page fault on it (each process mapping the arena must call it)
+    void prefault();
+
+    // All the memory allocated from now on, up to the next call, is bound
+    // to the given NUMA node (-1 means no binding). Regions bound to
+    // different nodes never share a page (of page_size(backing) bytes), the
+    // arena must be sized accordingly.
+    void set_node(int node);
+
+    template <class T, class... Args>
+    T *make(Args &&...args) {
+        T *ptr = new (allocate(sizeof(T), alignof(T)))
+            T(std::forward<Args>(args)...);
+
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            destructors.emplace_back([ptr]() { ptr->~T(); });
+        }
+
+        return ptr;
+    }
+
+    // Array of n value-initialized elements, aligned at least to align
+    template <class T>
+    std::span<T> make_array(size_t n, size_t align = alignof(T)) {
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "Arena arrays must be trivially destructible!");
+
+        align = std::max(align, alignof(T));
+        T *ptr = static_cast<T *>(allocate(sizeof(T) * n, align));
+        for (size_t i = 0; i < n; ++i) {
+            new (ptr + i) T();
+        }
+
+        return std::span<T>(ptr, n);
+    }
+
+    static size_t page_size(huge_pages backing) {
+        return page_size_of(backing);
+    }
+
+    const std::string &name() const {
+        return shm_name;
+    }
+
+    size_t size() const {
+        return capacity;
+    }
+
+    size_t size_used() const {
+        return used;
+    }
+
+    huge_pages get_backing() const {
+        return backing;
+    }
+};
+
+#endif // RTDAG_ARENA_H
@@ -0,0 +1,213 @@
+#include "newstuff/blame.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+static std::vector<path_node>
+critical_path(const Dag &dag, const std::vector<TaskJobs> &jobs, int sink,
+              s64 iter) {
+    std::vector<path_node> path;
+
+    const job_record *last_job = jobs[sink].find(iter);
+    if (!last_job) {
+        return path;
+    }
+
+    // The span of each node ends when it published the instance to the
+    // next node on the path, or when the instance is over for the sink
+    s64 done = last_job->pushed;
+
+    int task = sink;
+    while (task >= 0) {
+        const job_record *r = jobs[task].find(iter);
+        if (!r) {
+            // Not recorded, the path cannot be rebuilt further
+            break;
+        }
+
+        // The predecessor that published this instance to the node last,
+        // if any, which is when the node became ready
+        int last = -1;
+        s64 ready = r->release;
+        for (const auto &edge : dag.edges) {
+            if (edge.to != task) {
+                continue;
+            }
+            const s64 published = edge.published_time(iter);
+            if (last < 0 || published > ready) {
+                last = edge.from;
+                ready = published;
+            }
+        }
+
+        // The node may still be busy with its previous job once ready, it
+        // runs this one only after that (the release if unknown)
+        const job_record *prev = jobs[task].find(iter - 1);
+        const s64 prev_end = prev ? prev->pushed : r->release;
+        const s64 idle = std::max(prev_end, r->release);
+        const s64 runnable = std::max(ready, prev_end);
+
+        path.push_back(path_node{
+            .task = task,
+            .wait = std::max(ready, idle) - idle,
+            .backlog = runnable - ready,
+            .wakeup = r->wakeup - runnable,
+            .exec = r->end - r->start,
+            .gap = (r->start - r->wakeup) + (done - r->end),
+        });
+
+        done = ready;
+        task = last;
+    }
+
+    // Each node spans from becoming ready to the next one becoming ready,
+    // hence the whole path from the release to the end of the instance
+    if (task < 0) {
+        s64 sum = 0;
+        for (const path_node &node : path) {
+            sum += node.backlog + node.wakeup + node.exec + node.gap;
+        }
+        assert(sum == last_job->pushed - last_job->release);
+        (void)sum;
+    }
+
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+BlameReport::BlameReport(const Dag &dag,
+                         const std::vector<std::unique_ptr<Task>> &tasks) :
+    dag(dag),
+    tasks(tasks) {
+    const s64 first = dag.startup.warmup_activations;
+
+    std::vector<TaskJobs> jobs;
+    int sink = -1;
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        jobs.emplace_back(tasks[t]->records, first);
+        if (tasks[t]->is_sink()) {
+            sink = t;
+        }
+    }
+
+    for (s64 m = dag.first_kept(); sink >= 0 && m < dag.num_measured(); ++m) {
+        if (!dag.missed(m)) {
+            continue;
+        }
+        const microseconds response = dag.response_time(m);
+
+        missed_instance miss = {
+            .iter = first + m,
+            .response = response,
+            .path = critical_path(dag, jobs, sink, first + m),
+            .task_blamed = -1,
+            .edge_blamed = -1,
+        };
+
+        // Time spent by the node itself, on this job or on the previous
+        const auto own = [](const path_node &node) {
+            return node.backlog + node.exec + node.gap;
+        };
+
+        // The originator is never at the end of an edge
+        for (size_t n = 0; n < miss.path.size(); ++n) {
+            const path_node &node = miss.path[n];
+            if (miss.task_blamed < 0 ||
+                own(node) > own(miss.path[miss.task_blamed])) {
+                miss.task_blamed = n;
+            }
+            if (n > 0 && (miss.edge_blamed < 0 ||
+                          node.wakeup > miss.path[miss.edge_blamed].wakeup)) {
+                miss.edge_blamed = n;
+            }
+        }
+
+        if (miss.task_blamed >= 0) {
+            task_blames[miss.path[miss.task_blamed].task]++;
+        }
+        if (miss.edge_blamed >= 0) {
+            edge_blames[{miss.path[miss.edge_blamed - 1].task,
+                         miss.path[miss.edge_blamed].task}]++;
+        }
+
+        misses.push_back(std::move(miss));
+    }
+}
+
+template <class Map>
+static auto most_often(const Map &blames) {
+    return std::max_element(blames.begin(), blames.end(),
+                            [](const auto &a, const auto &b) {
+                                return a.second < b.second;
+                            });
+}
+
+// Sorted by number of misses, most often first
+template <class Map>
+static auto by_count(const Map &blames) {
+    std::vector<std::pair<typename Map::key_type, int>> v(blames.begin(),
+                                                          blames.end());
+    std::stable_sort(v.begin(), v.end(), [](const auto &a, const auto &b) {
+        return a.second > b.second;
+    });
+    return v;
+}
+
+int BlameReport::worst_task() const {
+    const auto it = most_often(task_blames);
+    return it == task_blames.end() ? -1 : it->first;
+}
+
+std::pair<int, int> BlameReport::worst_edge() const {
+    const auto it = most_often(edge_blames);
+    return it == edge_blames.end() ? std::pair(-1, -1) : it->first;
+}
+
+static double us(s64 ns) {
+    return ns / 1000.;
+}
+
+void BlameReport::write(std::ostream &os) const {
+    char line[160];
+
+    os << "DAG " << dag.name << ": " << misses.size()
+       << " deadline misses out of " << dag.num_measured() - dag.first_kept()
+       << " activations (deadline " << dag.e2e_deadline.count() << " us)\n";
+
+    for (const auto &miss : misses) {
+        os << "\ninstance " << miss.iter << ", response "
+           << miss.response.count() << " us, critical path:\n";
+
+        std::snprintf(line, sizeof(line),
+                      "  %-16s %12s %12s %12s %12s %12s\n", "task",
+                      "wait(us)", "backlog(us)", "wakeup(us)", "exec(us)",
+                      "gap(us)");
+        os << line;
+
+        for (size_t n = 0; n < miss.path.size(); ++n) {
+            const path_node &node = miss.path[n];
+            std::snprintf(line, sizeof(line),
+                          "  %-16s %12.3f %12.3f %12.3f %12.3f %12.3f%s%s\n",
+                          tasks[node.task]->name.c_str(), us(node.wait),
+                          us(node.backlog), us(node.wakeup), us(node.exec),
+                          us(node.gap),
+                          int(n) == miss.task_blamed ? "  <- task" : "",
+                          int(n) == miss.edge_blamed ? "  <- edge" : "");
+            os << line;
+        }
+    }
+
+    os << "\nmisses blamed on each task (largest backlog, execution and gap "
+          "on the critical path):\n";
+    for (const auto &[task, count] : by_count(task_blames)) {
+        os << "  " << tasks[task]->name << " " << count << "\n";
+    }
+
+    os << "\nmisses blamed on each edge (largest wake-up latency on the "
+          "critical path):\n";
+    for (const auto &[edge, count] : by_count(edge_blames)) {
+        os << "  n" << edge.first << "_n" << edge.second << " " << count
+           << "\n";
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef RTDAG_BLAME_H
+#define RTDAG_BLAME_H
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "newstuff/rtask.h"
+
+// One node on the critical path of a DAG instance. The path is rebuilt
+// backwards from the sink, following at each node the predecessor that
+// published the instance on its edge to the node last, which is when the
+// node became ready (the release for the originator). Times are in ns:
+//
+//  wait:    how long the node was idle before becoming ready (after its
+//           previous job or the release), waiting for its last predecessor
+//  backlog: how long the node was still busy with its previous job once
+//           ready (pipelining)
+//  wakeup:  from becoming ready, and done with its previous job, to running
+//           with all its inputs (wake-up latency)
+//  exec:    the work of the job
+//  gap:     the rest of the job up to publishing the instance to the next
+//           node on the path (reading and publishing the edges, blocked
+//           pushes, preemptions outside of the work), up to the end of the
+//           instance for the sink
+//
+// The backlog, wakeup, exec and gap of all the nodes add up to the
+// response time.
+struct path_node {
+    int task;
+    s64 wait;
+    s64 backlog;
+    s64 wakeup;
+    s64 exec;
+    s64 gap;
+};
+
+struct missed_instance {
+    s64 iter;
+    microseconds response;
+    std::vector<path_node> path;
+
+    // Index in the path of the node with the largest backlog, execution
+    // and gap, and of the node at the end of the edge with the largest
+    // wake-up latency (-1 if there is no such node or edge)
+    int task_blamed;
+    int edge_blamed;
+};
+
+// Critical paths of all the instances that missed the end-to-end deadline,
+// computed from the job records once the tasks are done
+class BlameReport {
+    const Dag &dag;
+    const std::vector<std::unique_ptr<Task>> &tasks;
+    std::vector<missed_instance> misses;
+
+    // Number of misses blamed on each task and on each edge (from, to)
+    std::map<int, int> task_blames;
+    std::map<std::pair<int, int>, int> edge_blames;
+
+public:
+    BlameReport(const Dag &dag,
+                const std::vector<std::unique_ptr<Task>> &tasks);
+
+    size_t size() const {
+        return misses.size();
+    }
+
+    // Task and edge blamed most often (-1 if none)
+    int worst_task() const;
+    std::pair<int, int> worst_edge() const;
+
+    void write(std::ostream &os) const;
+};
+
+#endif // RTDAG_BLAME_H
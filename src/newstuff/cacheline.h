@@ -0,0 +1,11 @@
+#ifndef RTDAG_CACHELINE_H
+#define RTDAG_CACHELINE_H
+
+#include <cstddef>
+
+// Data written by tasks that may run on different cores is aligned (and
+// padded) to this size, so that it never shares a cache line with data
+// written by somebody else (false sharing)
+constexpr size_t cache_line_size = 64;
+
+#endif // RTDAG_CACHELINE_H
@@ -0,0 +1,167 @@
+#include "newstuff/calibdb.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/utsname.h>
+
+#include "logging.h"
+
+static std::string cpu_model() {
+    std::ifstream f("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.rfind("model name", 0) != 0) {
+            continue;
+        }
+
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            break;
+        }
+
+        // Tabs separate the fields of the database
+        std::string model = line.substr(line.find_first_not_of(" ", colon + 1));
+        std::replace(model.begin(), model.end(), '\t', ' ');
+        return model;
+    }
+    return "unknown";
+}
+
+static std::ifstream cpufreq_file(int cpu, const char *name) {
+    std::string path = "/sys/devices/system/cpu/cpu";
+    path += std::to_string(cpu);
+    path += "/cpufreq/";
+    path += name;
+    return std::ifstream(path);
+}
+
+static long cpufreq_khz(int cpu, const char *name) {
+    std::ifstream f = cpufreq_file(cpu, name);
+    long khz = 0;
+    return f >> khz ? khz : 0;
+}
+
+static std::string cpufreq_governor(int cpu) {
+    std::ifstream f = cpufreq_file(cpu, "scaling_governor");
+    std::string governor;
+    return f >> governor ? governor : "none";
+}
+
+long cpu_cur_freq_khz(int cpu) {
+    return cpufreq_khz(cpu, "scaling_cur_freq");
+}
+
+static std::string kernel_release() {
+    struct utsname u;
+    return uname(&u) == 0 ? u.release : "unknown";
+}
+
+calib_key calib_key_of(int cpu, const std::string &type, int matrix_size,
+                       const std::string &load) {
+    return calib_key{
+        .cpu_model = cpu_model(),
+        .cpu = cpu,
+        .governor = cpufreq_governor(cpu),
+        .min_freq_khz = cpufreq_khz(cpu, "scaling_min_freq"),
+        .max_freq_khz = cpufreq_khz(cpu, "scaling_max_freq"),
+        .kernel = kernel_release(),
+        .type = type,
+        .matrix_size = matrix_size,
+        .load = load,
+    };
+}
+
+std::string CalibDb::default_path() {
+    if (const char *path = std::getenv("RTDAG_CALIB_DB")) {
+        return path;
+    }
+
+    const char *home = std::getenv("HOME");
+    return std::string(home ? home : ".") + "/.rtdag_calib";
+}
+
+CalibDb::CalibDb(const std::string &path) : path(path) {
+    std::ifstream f(path);
+    std::string line;
+    for (int n = 1; std::getline(f, line); ++n) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        std::istringstream ss(line);
+        for (std::string field; std::getline(ss, field, '\t');) {
+            fields.push_back(field);
+        }
+
+        calib_key key;
+        float ticks_per_us = 0;
+        try {
+            if (fields.size() != 10) {
+                throw std::invalid_argument("wrong number of fields");
+            }
+            key = calib_key{
+                .cpu_model = fields[0],
+                .cpu = std::stoi(fields[1]),
+                .governor = fields[2],
+                .min_freq_khz = std::stol(fields[3]),
+                .max_freq_khz = std::stol(fields[4]),
+                .kernel = fields[5],
+                .type = fields[6],
+                .matrix_size = std::stoi(fields[7]),
+                .load = fields[8],
+            };
+            ticks_per_us = std::stof(fields[9]);
+        } catch (const std::logic_error &) {
+            LOG(WARNING, "%s:%d: invalid calibration entry, ignored\n",
+                path.c_str(), n);
+            continue;
+        }
+
+        set(key, ticks_per_us);
+    }
+}
+
+std::optional<float> CalibDb::find(const calib_key &key) const {
+    for (const auto &[k, ticks_per_us] : entries) {
+        if (k == key) {
+            return ticks_per_us;
+        }
+    }
+    return std::nullopt;
+}
+
+void CalibDb::set(const calib_key &key, float ticks_per_us) {
+    for (auto &[k, v] : entries) {
+        if (k == key) {
+            v = ticks_per_us;
+            return;
+        }
+    }
+    entries.emplace_back(key, ticks_per_us);
+}
+
+bool CalibDb::save() const {
+    // Written aside and renamed, readers never see a partial file
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp);
+        f << "# cpu_model\tcpu\tgovernor\tmin_freq_khz\tmax_freq_khz\tkernel\t"
+             "type\tmatrix_size\tload\tticks_per_us\n";
+        for (const auto &[k, ticks_per_us] : entries) {
+            f << k.cpu_model << '\t' << k.cpu << '\t' << k.governor << '\t'
+              << k.min_freq_khz << '\t' << k.max_freq_khz << '\t' << k.kernel
+              << '\t' << k.type << '\t' << k.matrix_size << '\t' << k.load
+              << '\t' << ticks_per_us << '\n';
+        }
+        if (!f.flush()) {
+            return false;
+        }
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,64 @@
+#ifndef RTDAG_CALIBDB_H
+#define RTDAG_CALIBDB_H
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// What a calibration of ticks_per_us depends on: the CPU it ran on, how its
+// frequency is set (the cpufreq governor and limits in kHz, "none" and 0 if
+// unknown, which unlike the current frequency do not change when the CPU
+// goes idle) and the kernel, plus the task type, the size of its matrices
+// and whether the other CPUs were busy ("isolated" or "loaded")
+struct calib_key {
+    std::string cpu_model;
+    int cpu;
+    std::string governor;
+    long min_freq_khz;
+    long max_freq_khz;
+    std::string kernel;
+    std::string type;
+    int matrix_size;
+    std::string load;
+
+    bool operator==(const calib_key &) const = default;
+};
+
+// The current frequency of the given CPU in kHz (0 if unknown)
+long cpu_cur_freq_khz(int cpu);
+
+// The key of the given CPU of this system, as it is now
+calib_key calib_key_of(int cpu, const std::string &type, int matrix_size,
+                       const std::string &load);
+
+// Calibrations saved by rtdag -c, in a text file with one entry per line:
+// the fields of the key and ticks_per_us, separated by tabs. The file is
+// in $RTDAG_CALIB_DB, or in ~/.rtdag_calib by default.
+class CalibDb {
+    std::string path;
+    std::vector<std::pair<calib_key, float>> entries;
+
+public:
+    static std::string default_path();
+
+    // A missing file is an empty database
+    explicit CalibDb(const std::string &path = default_path());
+
+    const std::string &get_path() const {
+        return path;
+    }
+
+    bool empty() const {
+        return entries.empty();
+    }
+
+    std::optional<float> find(const calib_key &key) const;
+
+    // Replaces the entry with the same key, if any
+    void set(const calib_key &key, float ticks_per_us);
+
+    // Rewrites the whole file, returns false on failure
+    bool save() const;
+};
+
+#endif // RTDAG_CALIBDB_H
@@ -0,0 +1,99 @@
+#include "newstuff/ftrace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "logging.h"
+
+std::optional<ftrace_mode> ftrace_mode_from_string(const std::string &s) {
+    if (s == "none") {
+        return ftrace_mode::NONE;
+    }
+    if (s == "markers") {
+        return ftrace_mode::MARKERS;
+    }
+    if (s == "window") {
+        return ftrace_mode::WINDOW;
+    }
+    return std::nullopt;
+}
+
+static int open_tracefs(const std::string &path, const char *file) {
+    const std::string fname = path + "/" + file;
+
+    int fd = open(fname.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd < 0) {
+        LOG(ERROR, "could not open %s: %s\n", fname.c_str(),
+            std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+// Errors are ignored, there is nothing to do about them while running
+static void write_string(int fd, const char *s, size_t len) {
+    if (fd >= 0) {
+        ssize_t res = write(fd, s, len);
+        (void)res;
+    }
+}
+
+Ftrace::Ftrace(const std::string &path, ftrace_mode mode, bool snapshot) {
+    marker_fd = open_tracefs(path, "trace_marker");
+
+    if (mode == ftrace_mode::WINDOW) {
+        on_fd = open_tracefs(path, "tracing_on");
+
+        // Nothing before the measured activations
+        stop();
+    }
+
+    if (snapshot) {
+        snapshot_fd = open_tracefs(path, "snapshot");
+
+        // The first snapshot allocates the whole spare buffer: take it now
+        // and clear it, so that a miss only swaps the buffers
+        write_string(snapshot_fd, "1\n", 2);
+        write_string(snapshot_fd, "2\n", 2);
+    }
+}
+
+Ftrace::~Ftrace() {
+    for (int fd : {marker_fd, on_fd, snapshot_fd}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void Ftrace::mark(const char *fmt, ...) {
+    char buf[128];
+
+    va_list args;
+    va_start(args, fmt);
+    int len = std::vsnprintf(buf, sizeof(buf) - 1, fmt, args);
+    va_end(args);
+
+    len = std::min<int>(len, sizeof(buf) - 2);
+    buf[len++] = '\n';
+    write_string(marker_fd, buf, len);
+}
+
+void Ftrace::start() {
+    write_string(on_fd, "1\n", 2);
+}
+
+void Ftrace::stop() {
+    write_string(on_fd, "0\n", 2);
+}
+
+void Ftrace::snapshot() {
+    write_string(snapshot_fd, "1\n", 2);
+}
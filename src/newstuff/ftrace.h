@@ -0,0 +1,50 @@
+#ifndef RTDAG_FTRACE_H
+#define RTDAG_FTRACE_H
+
+#include <optional>
+#include <string>
+
+// Markers written in the ftrace buffer, to line up the jobs of the tasks
+// with the scheduling events recorded by the kernel (e.g., with trace-cmd or
+// perf sched). Markers are short lines:
+//
+//  rtdag B <task> <iter>          start of the work of a job
+//  rtdag E <task> <iter>          end of the work of a job
+//  rtdag S <from> <to> <iter>     edge signaled to the consumer
+//  rtdag M <iter> <response_us>   DAG deadline miss
+enum class ftrace_mode {
+    NONE,    // no markers
+    MARKERS, // markers only, tracing is left as it is
+    WINDOW,  // markers, tracing is on during the measured activations only
+};
+
+std::optional<ftrace_mode> ftrace_mode_from_string(const std::string &s);
+
+// The files of tracefs, opened once before the tasks are started (child
+// processes inherit them) and written with a single write(2) each
+class Ftrace {
+    int marker_fd = -1;
+    int on_fd = -1;
+    int snapshot_fd = -1;
+
+public:
+    // Exits if the files cannot be opened. The path is the tracefs mount
+    // point, any directory with the same files works (e.g., for testing)
+    Ftrace(const std::string &path, ftrace_mode mode, bool snapshot);
+    ~Ftrace();
+
+    Ftrace(const Ftrace &) = delete;
+    Ftrace &operator=(const Ftrace &) = delete;
+
+    void mark(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    // Turn tracing on and off around the measured activations (WINDOW mode
+    // only)
+    void start();
+    void stop();
+
+    // Takes a snapshot of the trace buffer, if enabled
+    void snapshot();
+};
+
+#endif // RTDAG_FTRACE_H
@@ -0,0 +1,43 @@
+#ifndef RTDAG_FUTEX_H
+#define RTDAG_FUTEX_H
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "newstuff/integers.h"
+
+// Thin wrappers around the futex(2) system call, used by the lock-free
+// MultiQueue backend. When all tasks of a DAG live in the same address space
+// we can use the cheaper process-private futexes, otherwise the words live
+// in shared memory and must be shared futexes.
+#if RTDAG_TASK_IMPL == TASK_IMPL_PROCESS
+#define RTDAG_FUTEX_FLAGS 0
+#else
+#define RTDAG_FUTEX_FLAGS FUTEX_PRIVATE_FLAG
+#endif
+
+using futex_word = std::atomic<u32>;
+
+static_assert(sizeof(futex_word) == sizeof(u32),
+              "std::atomic<u32> cannot be used as a futex word!");
+
+// Sleeps until woken up, as long as the word still contains the expected
+// value. Spurious wakeups are possible: callers MUST re-check their
+// condition after returning.
+static inline void futex_wait(futex_word &word, u32 expected) {
+    syscall(SYS_futex, reinterpret_cast<u32 *>(&word),
+            FUTEX_WAIT | RTDAG_FUTEX_FLAGS, expected, nullptr, nullptr, 0);
+}
+
+// Wakes up at most count threads sleeping on the word
+static inline void futex_wake(futex_word &word, int count = INT_MAX) {
+    syscall(SYS_futex, reinterpret_cast<u32 *>(&word),
+            FUTEX_WAKE | RTDAG_FUTEX_FLAGS, count, nullptr, nullptr, 0);
+}
+
+#endif // RTDAG_FUTEX_H
@@ -0,0 +1,89 @@
+#ifndef RTDAG_FUTEX_WAIT_H
+#define RTDAG_FUTEX_WAIT_H
+
+#include <sched.h>
+
+#include "logging.h"
+#include "newstuff/futex.h"
+#include "newstuff/integers.h"
+#include "newstuff/mtime.h"
+#include "newstuff/wait_policy.h"
+
+// Waiting on a futex word according to a wait_policy, shared by the
+// lock-free MultiQueue and the slot pools of the edges.
+//
+// The highest bit of the word is set whenever a thread is (about to be)
+// sleeping on it, so that the side that updates the word knows it has to
+// wake it up; the other bits are for the caller. Whoever makes the
+// condition of the waiter true MUST clear the flag in the same update and
+// pass the previous value to futex_notify().
+static constexpr u32 FUTEX_WAITER = u32(1) << 31;
+static constexpr u32 FUTEX_COUNT_MASK = ~FUTEX_WAITER;
+
+template <class Ready>
+static inline u32 futex_wait_block(futex_word &word, u32 state, Ready ready) {
+    while (!ready(state)) {
+        if (!(state & FUTEX_WAITER)) {
+            if (!word.compare_exchange_weak(state, state | FUTEX_WAITER,
+                                            std::memory_order_acquire)) {
+                continue;
+            }
+            state |= FUTEX_WAITER;
+        }
+
+        futex_wait(word, state);
+        state = word.load(std::memory_order_acquire);
+    }
+    return state;
+}
+
+// Waits until ready() holds on the value of word, returns that value.
+// spin_limit is the maximum busy-wait time for the SPIN_BLOCK policy.
+template <class Ready>
+static inline u32 futex_wait_until(futex_word &word, wait_policy policy,
+                                   nanoseconds spin_limit, Ready ready) {
+    u32 state = word.load(std::memory_order_acquire);
+    if (ready(state)) {
+        return state;
+    }
+
+    LOG_DEBUG("wait() suspending...\n");
+
+    switch (policy) {
+    case wait_policy::SPIN:
+        while (!ready(state = word.load(std::memory_order_acquire))) {
+            cpu_relax();
+        }
+        break;
+    case wait_policy::YIELD:
+        while (!ready(state = word.load(std::memory_order_acquire))) {
+            sched_yield();
+        }
+        break;
+    case wait_policy::SPIN_BLOCK: {
+        const auto until = to_nanoseconds(curtime()) + spin_limit;
+        while (!ready(state = word.load(std::memory_order_acquire)) &&
+               to_nanoseconds(curtime()) < until) {
+            cpu_relax();
+        }
+        state = futex_wait_block(word, state, ready);
+        break;
+    }
+    case wait_policy::BLOCK:
+        state = futex_wait_block(word, state, ready);
+        break;
+    }
+
+    LOG_DEBUG("wait() woken up...\n");
+    return state;
+}
+
+// Wakes up whoever is waiting on word, old is the value of the word before
+// it was updated by the caller
+static inline void futex_notify(futex_word &word, u32 old) {
+    if (old & FUTEX_WAITER) {
+        futex_wake(word, 1);
+    }
+}
+
+#endif // RTDAG_FUTEX_WAIT_H
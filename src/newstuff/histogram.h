@@ -0,0 +1,167 @@
+#ifndef RTDAG_HISTOGRAM_H
+#define RTDAG_HISTOGRAM_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdio>
+#include <limits>
+#include <ostream>
+#include <string>
+
+#include "newstuff/integers.h"
+
+// Fixed-memory histogram of latencies in nanoseconds, with logarithmic
+// buckets like HDR histograms: values below sub_count are counted exactly,
+// above that each power of two is split in half_count linear buckets, so
+// the relative error is always below 1 / half_count (1.6%).
+//
+// Values up to max_value (about 18 minutes) are recorded, larger ones are
+// counted in the last bucket. Recording is a handful of integer operations,
+// with no allocation, so it can be done in the hot path by a single writer.
+class LatencyHistogram {
+    static constexpr int sub_bits = 7;
+    static constexpr u64 sub_count = u64(1) << sub_bits;
+    static constexpr u64 half_count = sub_count / 2;
+    static constexpr int max_bits = 40;
+
+public:
+    static constexpr u64 max_value = (u64(1) << max_bits) - 1;
+
+private:
+    static constexpr size_t nbuckets =
+        (max_bits - sub_bits + 1) * half_count + half_count;
+
+    // Values above the threshold are counted as misses (0 disables it)
+    const u64 threshold;
+
+    u64 count = 0;
+    u64 sum = 0;
+    u64 min = std::numeric_limits<u64>::max();
+    u64 max = 0;
+    u64 misses = 0;
+    std::array<u64, nbuckets> buckets = {};
+
+    static size_t bucket_of(u64 value) {
+        if (value < sub_count) {
+            return value;
+        }
+
+        const int shift = std::bit_width(value) - sub_bits;
+        return shift * half_count + (value >> shift);
+    }
+
+    // The largest value counted in the bucket
+    static u64 highest_in(size_t bucket) {
+        if (bucket < sub_count) {
+            return bucket;
+        }
+
+        const int shift = bucket / half_count - 1;
+        const u64 lowest = (bucket % half_count + half_count) << shift;
+        return lowest + (u64(1) << shift) - 1;
+    }
+
+public:
+    explicit LatencyHistogram(u64 threshold = 0) : threshold(threshold) {}
+
+    void record(u64 value) {
+        value = std::min(value, max_value);
+
+        buckets[bucket_of(value)]++;
+        count++;
+        sum += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+
+        if (threshold > 0 && value > threshold) {
+            misses++;
+        }
+    }
+
+    // Forgets all the values, keeping the threshold
+    void reset() {
+        count = 0;
+        sum = 0;
+        min = std::numeric_limits<u64>::max();
+        max = 0;
+        misses = 0;
+        buckets.fill(0);
+    }
+
+    u64 size() const {
+        return count;
+    }
+
+    u64 deadline_misses() const {
+        return misses;
+    }
+
+    u64 minimum() const {
+        return count ? min : 0;
+    }
+
+    u64 maximum() const {
+        return max;
+    }
+
+    // How late the latest value was with respect to the threshold (negative
+    // if all values were below it)
+    s64 max_lateness() const {
+        return s64(max) - s64(threshold);
+    }
+
+    double mean() const {
+        return count ? double(sum) / count : 0;
+    }
+
+    // The value below which the given fraction of the samples fall, within
+    // the resolution of the histogram
+    u64 percentile(double fraction) const {
+        if (count == 0) {
+            return 0;
+        }
+
+        const u64 rank = std::max<u64>(1, u64(fraction * count + 0.5));
+        u64 seen = 0;
+        for (size_t i = 0; i < nbuckets; ++i) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                return std::clamp(highest_in(i), min, max);
+            }
+        }
+
+        return max;
+    }
+
+    // One line with min, mean, percentiles and max in microseconds, plus
+    // the number of misses and the max lateness if there is a threshold
+    void summary(std::ostream &os) const {
+        const auto us = [](double ns) {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.3f", ns / 1000.);
+            return std::string(buf);
+        };
+
+        os << "n " << count;
+        if (count == 0) {
+            os << '\n';
+            return;
+        }
+
+        os << ", min " << us(min) << ", mean " << us(mean()) << ", p50 "
+           << us(percentile(0.5)) << ", p90 " << us(percentile(0.9))
+           << ", p99 " << us(percentile(0.99)) << ", p99.9 "
+           << us(percentile(0.999)) << ", p99.99 " << us(percentile(0.9999))
+           << ", max " << us(max) << " (us)";
+
+        if (threshold > 0) {
+            os << ", deadline misses " << misses << ", max lateness "
+               << us(max_lateness());
+        }
+
+        os << '\n';
+    }
+};
+
+#endif // RTDAG_HISTOGRAM_H
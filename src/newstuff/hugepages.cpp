@@ -0,0 +1,126 @@
+#include "newstuff/hugepages.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "logging.h"
+#include "newstuff/integers.h"
+
+// Available since Linux 5.14, defined here for older headers
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+std::optional<huge_pages> huge_pages_from_string(const std::string &s) {
+    if (s == "none") {
+        return huge_pages::NONE;
+    }
+    if (s == "thp") {
+        return huge_pages::THP;
+    }
+    if (s == "hugetlb") {
+        return huge_pages::HUGETLB;
+    }
+    return std::nullopt;
+}
+
+// The default huge page size, as reported in /proc/meminfo
+static size_t huge_page_size() {
+    static const size_t size = []() -> size_t {
+        std::ifstream f("/proc/meminfo");
+        std::string key;
+        size_t value;
+        while (f >> key >> value) {
+            if (key == "Hugepagesize:") {
+                return value * 1024;
+            }
+            f.ignore(64, '\n');
+        }
+
+        // The most common size
+        return 2 * 1024 * 1024;
+    }();
+
+    return size;
+}
+
+size_t page_size_of(huge_pages backing) {
+    if (backing == huge_pages::HUGETLB) {
+        return huge_page_size();
+    }
+    return sysconf(_SC_PAGESIZE);
+}
+
+void *map_pages(size_t len, huge_pages backing, bool shared) {
+    const int flags = (shared ? MAP_SHARED : MAP_PRIVATE) | MAP_ANONYMOUS;
+    void *addr = MAP_FAILED;
+
+    if (backing == huge_pages::HUGETLB) {
+        addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB,
+                    -1, 0);
+        if (addr == MAP_FAILED) {
+            LOG(WARNING,
+                "could not map %lu bytes of huge pages (%s), using "
+                "transparent huge pages instead\n",
+                len, std::strerror(errno));
+            backing = huge_pages::THP;
+        }
+    }
+
+    if (addr == MAP_FAILED) {
+        addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+    }
+
+    if (addr == MAP_FAILED) {
+        return nullptr;
+    }
+
+    if (backing == huge_pages::THP) {
+        advise_huge_pages(addr, len);
+    }
+
+    return addr;
+}
+
+void advise_huge_pages(void *addr, size_t len) {
+    if (madvise(addr, len, MADV_HUGEPAGE) < 0) {
+        LOG(WARNING, "madvise(MADV_HUGEPAGE) failed: %s\n",
+            std::strerror(errno));
+    }
+}
+
+void prefault(void *addr, size_t len) {
+    if (madvise(addr, len, MADV_POPULATE_WRITE) == 0) {
+        return;
+    }
+
+    // Older kernels: write each page with its own content
+    const size_t page = sysconf(_SC_PAGESIZE);
+    volatile u8 *p = static_cast<u8 *>(addr);
+    for (size_t i = 0; i < len; i += page) {
+        p[i] = p[i];
+    }
+}
+
+PageBuffer::PageBuffer(size_t size, huge_pages backing) {
+    const size_t page = page_size_of(backing);
+    len = (std::max<size_t>(size, 1) + page - 1) / page * page;
+
+    addr = map_pages(len, backing, false);
+    if (addr == nullptr) {
+        LOG(ERROR, "could not map %lu bytes: %s\n", len, std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+
+    prefault(addr, len);
+}
+
+PageBuffer::~PageBuffer() {
+    munmap(addr, len);
+}
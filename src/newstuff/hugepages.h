@@ -0,0 +1,59 @@
+#ifndef RTDAG_HUGEPAGES_H
+#define RTDAG_HUGEPAGES_H
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+
+// How the memory of the arena and of the task working sets is backed
+enum class huge_pages {
+    NONE,    // regular pages
+    THP,     // transparent huge pages, when the kernel can provide them
+    HUGETLB, // explicit huge pages, reserved in /proc/sys/vm/nr_hugepages
+};
+
+std::optional<huge_pages> huge_pages_from_string(const std::string &s);
+
+// Granularity of the memory mapped with the given backing: the default huge
+// page size for HUGETLB, the regular page size otherwise
+size_t page_size_of(huge_pages backing);
+
+// Maps len bytes (a multiple of page_size_of(backing)) of anonymous memory,
+// shared with the children forked after the call if shared is set. If no
+// explicit huge page is available, falls back to transparent huge pages with
+// a warning. Returns nullptr on failure.
+void *map_pages(size_t len, huge_pages backing, bool shared);
+
+// Asks the kernel to back an existing mapping with transparent huge pages
+void advise_huge_pages(void *addr, size_t len);
+
+// Touches every page in [addr, addr + len), so that no page fault is taken
+// later on. The content of the memory is preserved.
+void prefault(void *addr, size_t len);
+
+// Private anonymous memory, used for the working set of each task
+class PageBuffer {
+    void *addr = nullptr;
+    size_t len = 0;
+
+public:
+    PageBuffer(size_t size, huge_pages backing);
+    ~PageBuffer();
+
+    PageBuffer(const PageBuffer &) = delete;
+    PageBuffer &operator=(const PageBuffer &) = delete;
+
+    // The buffer as an array of n elements of type T, starting after the
+    // first offset elements
+    template <class T>
+    std::span<T> as(size_t offset, size_t n) const {
+        return std::span<T>(static_cast<T *>(addr) + offset, n);
+    }
+
+    size_t size() const {
+        return len;
+    }
+};
+
+#endif // RTDAG_HUGEPAGES_H
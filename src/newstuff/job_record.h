@@ -0,0 +1,171 @@
+#ifndef RTDAG_JOB_RECORD_H
+#define RTDAG_JOB_RECORD_H
+
+#include <algorithm>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include <sched.h>
+
+#include "newstuff/integers.h"
+#include "newstuff/mtime.h"
+#include "newstuff/perf.h"
+
+// Timestamps of a single job of a task, in nanoseconds on CLOCK_MONOTONIC
+struct job_record {
+    s64 iter;
+
+    // Release of the DAG instance the job belongs to
+    s64 release;
+
+    // All the inputs of the job became available
+    s64 wakeup;
+
+    // Start and end of the work of the job
+    s64 start;
+    s64 end;
+
+    // All the outputs of the job were published
+    s64 pushed;
+
+    // The CPU the job ended on
+    s32 cpu;
+
+    // Reserved, always 0 (keeps the binary layout free of padding)
+    u32 flags;
+};
+
+static inline s64 to_record_time(const struct timespec &t) {
+    return to_nanoseconds(t).count();
+}
+
+// Records of the last jobs of a task, in a ring preallocated in the DAG
+// arena. Only the task itself writes its records, hence there is no
+// synchronization at all: recording a job costs a few stores and one clock
+// read per timestamp. The ring itself lives in the arena as well, so that
+// the main process can read the records once the task is done.
+//
+// With RTDAG_PERF_COUNTERS the performance counters of each job are kept in
+// a second ring, with the same indexing; otherwise that ring is empty.
+class JobRecords {
+    std::span<job_record> ring;
+    std::span<perf_sample> samples;
+
+    // Number of jobs recorded so far
+    s64 count = 0;
+
+public:
+    // Whether the samples include the hardware counters, set by the task
+    // once it opened them
+    bool hardware_samples = false;
+
+    JobRecords(std::span<job_record> ring,
+               std::span<perf_sample> samples = {}) :
+        ring(ring),
+        samples(samples) {}
+
+    bool has_samples() const {
+        return !samples.empty();
+    }
+
+    // The record of the given job, cleared, which is also the newest one
+    job_record &begin(s64 iter) {
+        job_record &r = ring[iter % ring.size()];
+        r = job_record{};
+        r.iter = iter;
+        count = iter + 1;
+        return r;
+    }
+
+    // The record of a job begun and not overwritten yet
+    job_record &get(s64 iter) {
+        return ring[iter % ring.size()];
+    }
+
+    const job_record &get(s64 iter) const {
+        return ring[iter % ring.size()];
+    }
+
+    // The counters of a job begun and not overwritten yet (requires
+    // has_samples)
+    perf_sample &get_sample(s64 iter) {
+        return samples[iter % samples.size()];
+    }
+
+    // Fills the timestamp with the current time
+    static void stamp(s64 &field) {
+        field = to_record_time(curtime());
+    }
+
+    // Records the CPU the caller is running on
+    static void stamp_cpu(s32 &field) {
+        field = sched_getcpu();
+    }
+
+    // The number of records from the first job on still in the ring
+    s64 size(s64 first) const {
+        const s64 oldest = std::max(first, count - s64(ring.size()));
+        return std::max<s64>(0, count - oldest);
+    }
+
+    // Calls f on the records from the first job on, oldest first
+    template <class F>
+    void for_each(s64 first, F f) const {
+        const s64 size = ring.size();
+        for (s64 i = std::max(first, count - size); i < count; ++i) {
+            f(ring[i % size]);
+        }
+    }
+
+    // Same for the counters (nothing without samples)
+    template <class F>
+    void for_each_sample(s64 first, F f) const {
+        const s64 size = samples.size();
+        for (s64 i = std::max(first, count - size); size && i < count; ++i) {
+            f(samples[i % size]);
+        }
+    }
+
+    // Dumps the records from the first job on, one per line, followed by
+    // the counters of the job if any
+    void dump(std::ostream &os, s64 first) const {
+        for_each(first, [&](const job_record &r) {
+            os << r.iter << " " << r.release << " " << r.wakeup << " "
+               << r.start << " " << r.end << " " << r.pushed << " " << r.cpu;
+            if (has_samples()) {
+                for (u64 c : samples[r.iter % samples.size()].count) {
+                    os << " " << c;
+                }
+            }
+            os << "\n";
+        });
+    }
+};
+
+// A copy of the records of the measured jobs of a task, looked up by
+// iteration, for the analyses done once the task is over
+class TaskJobs {
+    std::vector<job_record> jobs;
+
+public:
+    TaskJobs(const JobRecords &records, s64 first) {
+        records.for_each(first,
+                         [this](const job_record &r) { jobs.push_back(r); });
+    }
+
+    const std::vector<job_record> &all() const {
+        return jobs;
+    }
+
+    // nullptr if the job was not recorded (or not kept in the ring)
+    const job_record *find(s64 iter) const {
+        if (jobs.empty() || iter < jobs.front().iter ||
+            iter > jobs.back().iter) {
+            return nullptr;
+        }
+        return &jobs[iter - jobs.front().iter];
+    }
+};
+
+#endif // RTDAG_JOB_RECORD_H
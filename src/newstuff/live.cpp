@@ -0,0 +1,57 @@
+#include "newstuff/live.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "logging.h"
+
+LiveMetrics::LiveMetrics(const std::string &dag_name, u32 ntasks) :
+    size(segment_size(ntasks)),
+    owner(getpid()) {
+    shm_name = std::string("/") + live_prefix;
+    shm_name += dag_name + "-" + std::to_string(owner);
+
+    int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        LOG(ERROR, "shm_open(%s) failed: %s\n", shm_name.c_str(),
+            std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (ftruncate(fd, size) < 0) {
+        LOG(ERROR, "ftruncate(%s) failed: %s\n", shm_name.c_str(),
+            std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+
+    base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED) {
+        LOG(ERROR, "could not map %s: %s\n", shm_name.c_str(),
+            std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+
+    new (base) live_header{};
+    for (u32 i = 0; i < ntasks; ++i) {
+        new (&task(i)) live_task{};
+    }
+
+    header().ntasks = ntasks;
+    header().pid = owner;
+}
+
+LiveMetrics::~LiveMetrics() {
+    if (getpid() != owner) {
+        return;
+    }
+
+    munmap(base, size);
+    shm_unlink(shm_name.c_str());
+}
@@ -0,0 +1,161 @@
+#ifndef RTDAG_LIVE_H
+#define RTDAG_LIVE_H
+
+#include <atomic>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <type_traits>
+
+#include <sys/types.h>
+
+#include "newstuff/cacheline.h"
+#include "newstuff/integers.h"
+
+// Counters published while the DAG runs, in a named shared memory segment
+// (/dev/shm/rtdag-live-<dag_name>-<pid>) that rtdag-top attaches to.
+
+// Written by the sink after each measured activation
+struct live_dag_stats {
+    u64 activations;
+    u64 misses;
+    u64 last_response_ns;
+    u64 max_response_ns;
+};
+
+// Written by each task after each measured job
+struct live_task_stats {
+    u64 jobs;
+    u64 max_exec_ns;
+
+    // Total time spent pushing to the consumers, including the time
+    // blocked waiting for them to free up a slot
+    u64 push_ns;
+
+    // Jobs that missed the relative deadline of the task, and how late the
+    // latest job was (negative if none missed it)
+    u64 deadline_misses;
+    s64 max_lateness_ns;
+};
+
+// Single-writer sequence lock: the writer never waits, readers retry while
+// an update is in progress. The data is stored as words accessed
+// atomically, so that readers can copy it while it is being written.
+template <class T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable_v<T> &&
+                      sizeof(T) % sizeof(u64) == 0,
+                  "Seqlock data must be made of 64 bit words!");
+
+    static constexpr size_t nwords = sizeof(T) / sizeof(u64);
+
+    std::atomic<u32> seq = 0;
+    u64 words[nwords] = {};
+
+public:
+    void write(const T &value) {
+        u64 src[nwords];
+        std::memcpy(src, &value, sizeof(T));
+
+        const u32 s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < nwords; ++i) {
+            __atomic_store_n(&words[i], src[i], __ATOMIC_RELAXED);
+        }
+
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    // Gives up after the given number of attempts (e.g., if the writer
+    // died in the middle of an update)
+    std::optional<T> read(int attempts = 1000) const {
+        for (int i = 0; i < attempts; ++i) {
+            const u32 s = seq.load(std::memory_order_acquire);
+            if (s & 1) {
+                continue;
+            }
+
+            u64 dst[nwords];
+            for (size_t j = 0; j < nwords; ++j) {
+                dst[j] = __atomic_load_n(&words[j], __ATOMIC_RELAXED);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == s) {
+                T value;
+                std::memcpy(&value, dst, sizeof(T));
+                return value;
+            }
+        }
+
+        return std::nullopt;
+    }
+};
+
+constexpr char live_magic[8] = {'R', 'T', 'D', 'A', 'G', 'L', 'I', 'V'};
+constexpr u32 live_version = 2;
+
+// Prefix of the names of all the live segments
+constexpr const char *live_prefix = "rtdag-live-";
+
+struct live_header {
+    char magic[8];
+    u32 version;
+    u32 ntasks;
+    s64 pid;
+    s64 period_ns;
+    s64 deadline_ns;
+    s64 num_activations;
+    char dag_name[64];
+
+    alignas(cache_line_size) Seqlock<live_dag_stats> dag;
+};
+
+// One per task, after the header, on their own cache lines
+struct alignas(cache_line_size) live_task {
+    char name[48];
+    s32 cpu;
+    u32 unused;
+
+    Seqlock<live_task_stats> stats;
+};
+
+// The segment of this process, created before the tasks are started and
+// removed when the DAG is destroyed
+class LiveMetrics {
+    std::string shm_name;
+    void *base = nullptr;
+    size_t size = 0;
+    pid_t owner;
+
+public:
+    LiveMetrics(const std::string &dag_name, u32 ntasks);
+    ~LiveMetrics();
+
+    LiveMetrics(const LiveMetrics &) = delete;
+    LiveMetrics &operator=(const LiveMetrics &) = delete;
+
+    live_header &header() {
+        return *static_cast<live_header *>(base);
+    }
+
+    live_task &task(u32 i) {
+        return reinterpret_cast<live_task *>(&header() + 1)[i];
+    }
+
+    // Makes the segment visible to the readers, once all the metadata has
+    // been filled in
+    void publish() {
+        std::atomic_thread_fence(std::memory_order_release);
+        header().version = live_version;
+        std::memcpy(header().magic, live_magic, sizeof(live_magic));
+    }
+
+    static size_t segment_size(u32 ntasks) {
+        return sizeof(live_header) + ntasks * sizeof(live_task);
+    }
+};
+
+#endif // RTDAG_LIVE_H
@@ -0,0 +1,139 @@
+#ifndef RTDAG_MEMTRAFFIC_H
+#define RTDAG_MEMTRAFFIC_H
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#include "newstuff/integers.h"
+
+#if RTDAG_MEM_NT_STORES == ON && defined(__SSE2__)
+#include <immintrin.h>
+#define RTDAG_HAVE_NT_STORES 1
+#else
+#define RTDAG_HAVE_NT_STORES 0
+#endif
+
+// Kernels used to emulate the memory traffic of the messages exchanged on
+// the edges when RTDAG_MEM_ACCESS is ON. They stream through the whole
+// message with wide vector operations, so that their cost is dominated by
+// the memory hierarchy rather than by the instructions they execute.
+//
+// With RTDAG_MEM_NT_STORES the stores bypass the caches (only on x86, other
+// architectures fall back to regular stores).
+
+// GCC vector extension, native on both SSE2 and NEON
+using mem_vector = u64 __attribute__((vector_size(16)));
+
+constexpr size_t mem_vector_size = sizeof(mem_vector);
+
+// Bytes moved by a job
+struct mem_traffic {
+    u64 read = 0;
+    u64 written = 0;
+};
+
+static inline bool mem_is_aligned(const u8 *p) {
+    return (reinterpret_cast<uintptr_t>(p) % mem_vector_size) == 0;
+}
+
+static inline mem_vector mem_load(const u8 *src) {
+    mem_vector v;
+    std::memcpy(&v, src, sizeof(v));
+    return v;
+}
+
+// dst MUST be aligned to mem_vector_size
+static inline void mem_store(u8 *dst, mem_vector v) {
+#if RTDAG_HAVE_NT_STORES
+    _mm_stream_si128(reinterpret_cast<__m128i *>(dst), (__m128i)v);
+#else
+    std::memcpy(dst, &v, sizeof(v));
+#endif
+}
+
+// Non-temporal stores are weakly ordered, they must be fenced before
+// publishing the message
+static inline void mem_store_fence() {
+#if RTDAG_HAVE_NT_STORES
+    _mm_sfence();
+#endif
+}
+
+// Writes value over the whole buffer
+static inline void mem_fill(std::span<u8> dst, u8 value) {
+    u8 *p = dst.data();
+    u8 *const end = p + dst.size();
+
+    while (p < end && !mem_is_aligned(p)) {
+        *p++ = value;
+    }
+
+    const mem_vector v = mem_vector{} + (0x0101010101010101ull * value);
+    for (; size_t(end - p) >= mem_vector_size; p += mem_vector_size) {
+        mem_store(p, v);
+    }
+
+    while (p < end) {
+        *p++ = value;
+    }
+
+    mem_store_fence();
+}
+
+// Copies src into dst, which must have the same size
+static inline void mem_copy(std::span<u8> dst, std::span<const u8> src) {
+#if RTDAG_HAVE_NT_STORES
+    u8 *p = dst.data();
+    u8 *const end = p + dst.size();
+    const u8 *s = src.data();
+
+    while (p < end && !mem_is_aligned(p)) {
+        *p++ = *s++;
+    }
+
+    for (; size_t(end - p) >= mem_vector_size;
+         p += mem_vector_size, s += mem_vector_size) {
+        mem_store(p, mem_load(s));
+    }
+
+    while (p < end) {
+        *p++ = *s++;
+    }
+
+    mem_store_fence();
+#else
+    // Already the best vectorized copy for the target
+    std::memcpy(dst.data(), src.data(), dst.size());
+#endif
+}
+
+// Reads the whole buffer, returning its XOR reduction
+static inline u64 mem_reduce(std::span<const u8> src) {
+    const u8 *p = src.data();
+    const u8 *const end = p + src.size();
+    u64 acc = 0;
+
+    // Independent accumulators to keep more loads in flight
+    mem_vector v0 = {}, v1 = {}, v2 = {}, v3 = {};
+    for (; size_t(end - p) >= 4 * mem_vector_size;
+         p += 4 * mem_vector_size) {
+        v0 ^= mem_load(p);
+        v1 ^= mem_load(p + mem_vector_size);
+        v2 ^= mem_load(p + 2 * mem_vector_size);
+        v3 ^= mem_load(p + 3 * mem_vector_size);
+    }
+
+    v0 ^= v1 ^ v2 ^ v3;
+    for (size_t i = 0; i < mem_vector_size / sizeof(u64); ++i) {
+        acc ^= v0[i];
+    }
+
+    while (p < end) {
+        acc ^= *p++;
+    }
+
+    return acc;
+}
+
+#endif // RTDAG_MEMTRAFFIC_H
@@ -1,131 +1,74 @@
 #ifndef RTDAG_MQUEUE_H
 #define RTDAG_MQUEUE_H
 
-#include <bitset>
-#include <condition_variable>
-#include <mutex>
+#include <algorithm>
+#include <span>
 #include <vector>
 
 #include "logging.h"
 #include "newstuff/integers.h"
+#include "newstuff/memtraffic.h"
+#include "newstuff/mtime.h"
+#include "newstuff/slot_pool.h"
 
-class MultiQueue {
-public:
-    // TODO: set the maximum number of tasks in CMake
-    using mask_type = std::bitset<RTDAG_MAX_TASKS>;
+// Maximum number of DAG instances that can be in flight at the same time,
+// i.e., the maximum number of elements buffered on each edge
+#if RTDAG_PIPELINING == ON
+#define RTDAG_MAX_INFLIGHT RTDAG_BUFFER_LINES
+#else
+#define RTDAG_MAX_INFLIGHT 1
+#endif
 
-private:
-    // Mutex to lock to access the multi queue
-    std::mutex mtx;
-
-    // Bitmask representing all the tasks that have already
-    // completed execution
-    mask_type arrived_mask; // zero-initialized
-
-    // Indicates the number of tasks waiting for the i-th
-    // elem to free up (zero-initialized in the constructor)
-    std::vector<int> waiting;
-
-    // The consumer waits on this variable
-    std::condition_variable cv_successor;
-
-    // Used to wait for the destination elem to free up
-    // (producers queue here)
-    std::vector<std::condition_variable> cv_predecessors;
-
-    // The pointers to the N vectors, one per task. Once initialized,
-    // before the DAG execution, this information is CONSTANT (refers back
-    // to each Edge)
-    std::vector<void *> buffers;
-
-    size_t inputs;
+// Select the MultiQueue implementation at compile time
+#if RTDAG_MQUEUE_IMPL == MQUEUE_IMPL_MUTEX
 
-    inline size_t num_predecessors() {
-        return waiting.size();
-    }
+#include "newstuff/mqueue_mutex.h"
+using MultiQueue = MutexMultiQueue;
 
-    // NOTICE: the lock MUST be held before calling this function
-    inline bool all_arrived() {
-        return arrived_mask.count() == num_predecessors();
-    }
+#elif RTDAG_MQUEUE_IMPL == MQUEUE_IMPL_FUTEX
 
-public:
-    MultiQueue(size_t size) : waiting(size == 0 ? 1 : size, 0), cv_predecessors(size == 0 ? 1 : size) {
-        if (size > arrived_mask.size()) {
-            throw std::logic_error(
-                "Exceeded maximum size for the multiqueue! Too many tasks!");
-        }
-        inputs = size;
-        buffers.resize(size == 0 ? 1 : size);
-    }
+#include "newstuff/mqueue_futex.h"
+using MultiQueue = FutexMultiQueue;
 
-    size_t size(void) {
-        return inputs;
-    }
-
-    // May block if the i-th elem is busy; returns 1 if all
-    // elems have been pushed as input to target (so it has
-    // been notified)
-    inline bool push(size_t i) {
-        if (i > waiting.size()) {
-            throw std::logic_error("Accessed oob bit in MultiQueue!");
-        }
-
-        std::unique_lock<std::mutex> lock(mtx);
-
-        while (arrived_mask.test(i)) {
-            waiting[i]++;
-            LOG_DEBUG("push() suspending...\n");
-            cv_predecessors[i].wait(lock);
-            LOG_DEBUG("push() woken up...\n");
-            waiting[i]--;
-        }
-
-        arrived_mask.set(i);
-        if (all_arrived()) {
-            // Wakeup whoever is waiting
-            cv_successor.notify_one();
-            return true;
-        }
-
-        // No notification
-        return false;
-    }
-
-    inline void pop() {
-        std::unique_lock<std::mutex> lock(mtx);
-
-        while (!all_arrived()) {
-            LOG_DEBUG("pop() suspending...\n");
-            cv_successor.wait(lock);
-            LOG_DEBUG("pop() woken up...\n");
-        }
-
-        arrived_mask.reset();
-
-        // Well done, now wake up everyone
-        for (size_t i = 0; i < waiting.size(); ++i) {
-            if (waiting[i] > 0) {
-                cv_predecessors[i].notify_one();
-            }
-        }
-    }
-
-    void set_buffer(size_t index, void *buffer) {
-        if (index > waiting.size()) {
-            throw std::logic_error("Accessed oob bit in MultiQueue!");
-        }
-
-        buffers[index] = buffer;
-    }
-};
+#endif
 
 struct Edge {
     const int from;
     const int to;
     const int push_idx;
     MultiQueue &mq;
-    std::vector<u8> msg;
+    const int msg_size;
+
+    // The messages exchanged on the edge, in slots of msg_size bytes. In
+    // copy mode there is one slot per DAG instance that can be in flight,
+    // plus one, so that the producer never overwrites a message that the
+    // consumer is still copying. In zero-copy mode this is the storage of
+    // the slot pool. The memory is owned by the DAG arena, so that it can
+    // be shared with other processes.
+    std::span<u8> msg;
+
+#if RTDAG_ZERO_COPY == ON
+    // Slots are loaned by the producer from here
+    SlotPool *pool = nullptr;
+
+    // The handle published for each instance in flight, indexed like the
+    // copy-mode slots
+    std::span<u32> published;
+
+    // The handle received by the consumer, released at the end of its job
+    u32 held = 0;
+#else
+    // Private buffers of the producer (tx) and of the consumer (rx), the
+    // message is copied from one to the other through msg. They are in the
+    // arena too, so that they are prefaulted with the rest of the edge.
+    std::span<u8> tx;
+    std::span<u8> rx;
+#endif
+
+    // When the message of each job was published, indexed like the job
+    // records. The producer writes it right before pushing, hence the
+    // consumer sees it once it popped the instance.
+    std::span<s64> published_at;
 
     template <class Value>
     Value &as_value() {
@@ -134,30 +77,128 @@ struct Edge {
 
     // The last argument is to differentiate with the other constructor
     template <class Value>
-    Edge(MultiQueue &mq, int from, int to, int push_idx, const Value &value,
-         bool unused) :
-        from(from), to(to), push_idx(push_idx), mq(mq), msg(sizeof(Value)) {
+    Edge(MultiQueue &mq, int from, int to, int push_idx, std::span<u8> buffer,
+         const Value &value, bool unused) :
+        from(from), to(to), push_idx(push_idx), mq(mq),
+        msg_size(sizeof(Value)), msg(buffer.first(sizeof(Value))) {
 
         (void)unused;
 
-        // Assign value to the buffer pointed by the vector
+        // Assign value to the buffer pointed by the span
         as_value<Value>() = value;
 
         set_buffer();
     }
 
-    Edge(MultiQueue &mq, int from, int to, int push_idx, int msg_size) :
-        from(from), to(to), push_idx(push_idx), mq(mq), msg(msg_size, '.') {
+#if RTDAG_ZERO_COPY == ON
+    // The published span must have one element per slot of the copy mode
+    Edge(MultiQueue &mq, int from, int to, int push_idx, SlotPool &pool,
+         std::span<u32> published, std::span<s64> published_at,
+         int msg_size) :
+        from(from), to(to), push_idx(push_idx), mq(mq), msg_size(msg_size),
+        msg(pool.data()), pool(&pool), published(published),
+        published_at(published_at) {
+        init_messages();
+        set_buffer();
+    }
+#else
+    // The buffer must be a multiple of msg_size, one slot per instance;
+    // tx and rx must be msg_size bytes each
+    Edge(MultiQueue &mq, int from, int to, int push_idx, std::span<u8> buffer,
+         std::span<u8> tx, std::span<u8> rx, std::span<s64> published_at,
+         int msg_size) :
+        from(from), to(to), push_idx(push_idx), mq(mq), msg_size(msg_size),
+        msg(buffer), tx(tx), rx(rx), published_at(published_at) {
+        init_messages();
+        set_buffer();
+    }
 
-        // The message is initialized with '.' (above) and a termination
-        // std::string character. This is to avoid errors when checking
-        // that the transferred data is correct.
-        msg[msg_size - 1] = '\0';
+    // The slot used by the given DAG instance (iteration)
+    std::span<u8> slot(int iter) {
+        const int nslots = msg.size() / msg_size;
+        return msg.subspan((iter % nslots) * msg_size, msg_size);
+    }
+#endif
+
+    // Producer side: returns the buffer where the message for the given
+    // instance must be written before publishing it
+    std::span<u8> loan(int iter) {
+#if RTDAG_ZERO_COPY == ON
+        const u32 handle = pool->loan();
+        published[iter % published.size()] = handle;
+        return pool->get(handle);
+#else
+        (void)iter;
+        return tx;
+#endif
+    }
 
-        set_buffer();
+    // The copy from the private buffer, if any, is accounted in traffic.
+    // Returns the time spent pushing, which includes the time blocked
+    // waiting for the consumer if it is late.
+    nanoseconds publish(int iter, mem_traffic &traffic) {
+#if RTDAG_ZERO_COPY != ON && RTDAG_MEM_ACCESS == ON
+        mem_copy(slot(iter), tx);
+        traffic.read += msg_size;
+        traffic.written += msg_size;
+#else
+        (void)traffic;
+#endif
+
+        // The values pushed in the multi-queue are meaningless, on the
+        // read side we always go check the message content anyway...
+        const struct timespec before = curtime();
+        published_at[iter % published_at.size()] =
+            to_nanoseconds(before).count();
+        mq.push(push_idx);
+        return to_nanoseconds(curtime() - before);
+    }
+
+    // When the message of the given job was published: MUST be called by
+    // the consumer after popping the instance, or once the tasks are done
+    // for the jobs still in the records
+    s64 published_time(s64 iter) const {
+        return published_at[iter % published_at.size()];
+    }
+
+    // Consumer side: returns the message of the given instance, MUST be
+    // called after the instance has been popped from the queue
+    std::span<u8> receive(int iter, mem_traffic &traffic) {
+#if RTDAG_ZERO_COPY == ON
+        (void)traffic;
+        held = published[iter % published.size()];
+        return pool->get(held);
+#else
+#if RTDAG_MEM_ACCESS == ON
+        mem_copy(rx, slot(iter));
+        traffic.read += msg_size;
+        traffic.written += msg_size;
+#else
+        (void)iter;
+        (void)traffic;
+#endif
+        return rx;
+#endif
+    }
+
+    // Consumer side: the message received last is not used anymore
+    void release() {
+#if RTDAG_ZERO_COPY == ON
+        pool->release(held);
+#endif
     }
 
 private:
+    void init_messages() {
+        // Each message is initialized with '.' and a termination
+        // std::string character. This is to avoid errors when checking
+        // that the transferred data is correct.
+        std::fill(msg.begin(), msg.end(), '.');
+        for (size_t i = msg_size; i <= msg.size(); i += msg_size) {
+            msg[i - 1] = '\0';
+        }
+    }
+
     void set_buffer() {
         mq.set_buffer(push_idx, msg.data());
     }
@@ -0,0 +1,200 @@
+#ifndef RTDAG_MQUEUE_FUTEX_H
+#define RTDAG_MQUEUE_FUTEX_H
+
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <stdexcept>
+
+#include "newstuff/cacheline.h"
+#include "newstuff/futex.h"
+#include "newstuff/futex_wait.h"
+#include "newstuff/integers.h"
+#include "newstuff/mtime.h"
+#include "newstuff/wait_policy.h"
+
+// Lock-free MultiQueue implementation. The join is an atomic arrival
+// counter per in-flight DAG instance, each predecessor owns a counter of
+// pending elements and both sides wait directly on those words according
+// to their wait_policy. Neither push() nor pop() take any lock and no
+// system call is performed unless somebody actually has to sleep.
+//
+// Each predecessor can push up to depth elements before blocking; elements
+// are popped in the same order they were pushed.
+//
+// The state written by each producer, by the consumer and the arrival
+// counters are each on their own cache lines, so that producers running on
+// different cores do not slow each other down.
+class alignas(cache_line_size) FutexMultiQueue {
+public:
+    // Only used to derive the maximum number of tasks supported
+    using mask_type = std::bitset<RTDAG_MAX_TASKS>;
+
+private:
+    // Number of predecessors that have already pushed to a cell, one per
+    // DAG instance that can be in flight. The consumer waits on these.
+    struct alignas(cache_line_size) arrival {
+        futex_word count;
+    };
+
+    // The state of each predecessor
+    struct alignas(cache_line_size) producer {
+        // Elements pushed but not popped yet, the producer waits on it
+        futex_word pending;
+
+        // The next cell to push to (accessed only by the producer)
+        u32 head;
+
+        // How the producer waits on pending
+        wait_policy policy;
+    };
+
+    // ----------- CONSTANT during the DAG execution -----------
+
+    // Number of elements each predecessor can push before blocking
+    u32 depth;
+
+    // Number of elements to wait for, at least one (the originator queue
+    // has no predecessors, but it is used by the sink to release it)
+    u32 predecessors;
+
+    size_t inputs;
+
+    // Maximum busy-wait time for the SPIN_BLOCK policy
+    nanoseconds spin_limit{0};
+
+    // The pointers to the N vectors, one per task (refers back to each
+    // Edge)
+    std::array<void *, RTDAG_MAX_TASKS> buffers;
+
+    // ----------------- Written at runtime -----------------
+
+    std::array<arrival, RTDAG_MAX_INFLIGHT> arrived;
+
+    std::array<producer, RTDAG_MAX_TASKS> producers;
+
+    // The cell the consumer will pop next (accessed only by the consumer)
+    alignas(cache_line_size) u32 tail = 0;
+
+    // How the consumer waits on the arrival counters
+    wait_policy consumer_policy = wait_policy::BLOCK;
+
+    // Waits until ready() holds on the value of word, returns that value
+    template <class Ready>
+    u32 wait(futex_word &word, wait_policy policy, Ready ready) {
+        return futex_wait_until(word, policy, spin_limit, ready);
+    }
+
+public:
+    FutexMultiQueue(size_t size, size_t depth = 1) :
+        depth(depth),
+        predecessors(size == 0 ? 1 : size),
+        inputs(size) {
+        if (size > producers.size()) {
+            throw std::logic_error(
+                "Exceeded maximum size for the multiqueue! Too many tasks!");
+        }
+        if (depth < 1 || depth > arrived.size()) {
+            throw std::logic_error("Invalid depth for the multiqueue!");
+        }
+
+        for (auto &cell : arrived) {
+            cell.count.store(0, std::memory_order_relaxed);
+        }
+        for (auto &p : producers) {
+            p.pending.store(0, std::memory_order_relaxed);
+            p.head = 0;
+            p.policy = wait_policy::BLOCK;
+        }
+        buffers.fill(nullptr);
+    }
+
+    size_t size(void) {
+        return inputs;
+    }
+
+    void set_consumer_policy(wait_policy policy) {
+        consumer_policy = policy;
+    }
+
+    void set_producer_policy(size_t i, wait_policy policy) {
+        if (i >= predecessors) {
+            throw std::logic_error("Accessed oob bit in MultiQueue!");
+        }
+        producers[i].policy = policy;
+    }
+
+    void set_spin_limit(nanoseconds limit) {
+        spin_limit = limit;
+    }
+
+    // May block if the i-th elem is busy; returns 1 if all
+    // elems have been pushed as input to target (so it has
+    // been notified)
+    inline bool push(size_t i) {
+        if (i >= predecessors) {
+            throw std::logic_error("Accessed oob bit in MultiQueue!");
+        }
+
+        producer &self = producers[i];
+
+        // Wait for one of our elements to free up
+        const u32 max_pending = depth;
+        wait(self.pending, self.policy, [max_pending](u32 state) {
+            return (state & FUTEX_COUNT_MASK) < max_pending;
+        });
+        self.pending.fetch_add(1, std::memory_order_acquire);
+
+        const u32 cell = self.head;
+        self.head = (cell + 1) % depth;
+
+        // Publishes also the content of the message to the consumer
+        futex_word &count = arrived[cell].count;
+        u32 old = count.fetch_add(1, std::memory_order_acq_rel);
+        if (((old + 1) & FUTEX_COUNT_MASK) == predecessors) {
+            // Wakeup whoever is waiting
+            futex_notify(count, old);
+            return true;
+        }
+
+        // No notification
+        return false;
+    }
+
+    inline void pop() {
+        const u32 cell = tail;
+        const u32 expected = predecessors;
+        futex_word &count = arrived[cell].count;
+        wait(count, consumer_policy, [expected](u32 state) {
+            return (state & FUTEX_COUNT_MASK) == expected;
+        });
+
+        // No predecessor can push to this cell again until its pending
+        // counter is decremented below, so nobody can touch the counter in
+        // the meantime
+        count.store(0, std::memory_order_relaxed);
+        tail = (cell + 1) % depth;
+
+        // Well done, now wake up everyone that was waiting (clearing the
+        // WAITER flag at the same time)
+        for (size_t i = 0; i < predecessors; ++i) {
+            producer &p = producers[i];
+            u32 old = p.pending.load(std::memory_order_relaxed);
+            while (!p.pending.compare_exchange_weak(
+                old, (old & FUTEX_COUNT_MASK) - 1, std::memory_order_release,
+                std::memory_order_relaxed)) {
+            }
+            futex_notify(p.pending, old);
+        }
+    }
+
+    void set_buffer(size_t index, void *buffer) {
+        if (index >= predecessors) {
+            throw std::logic_error("Accessed oob bit in MultiQueue!");
+        }
+
+        buffers[index] = buffer;
+    }
+};
+
+#endif // RTDAG_MQUEUE_FUTEX_H
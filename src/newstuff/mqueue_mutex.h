@@ -0,0 +1,189 @@
+#ifndef RTDAG_MQUEUE_MUTEX_H
+#define RTDAG_MQUEUE_MUTEX_H
+
+#include <array>
+#include <bitset>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+
+#include "logging.h"
+#include "newstuff/cacheline.h"
+#include "newstuff/integers.h"
+#include "newstuff/mtime.h"
+#include "newstuff/wait_policy.h"
+
+// The original MultiQueue implementation: every push/pop takes a mutex and
+// producers and consumer hand off through condition variables.
+//
+// Each predecessor can push up to depth elements before blocking, so that
+// up to depth DAG instances can be in flight on the same edge; elements are
+// popped in the same order they were pushed.
+//
+// All the state lives inside the object, with the lock-protected state on
+// its own cache lines.
+class alignas(cache_line_size) MutexMultiQueue {
+public:
+    // TODO: set the maximum number of tasks in CMake
+    using mask_type = std::bitset<RTDAG_MAX_TASKS>;
+
+private:
+    // The state of each predecessor (accessed only with the lock held)
+    struct alignas(cache_line_size) producer {
+        // Number of elements pushed and not popped yet, at most depth
+        size_t pending = 0;
+
+        // The next cell to push to
+        size_t head = 0;
+
+        // Indicates the number of tasks waiting for the elem to free up
+        int waiting = 0;
+
+        // Used to wait for the destination elem to free up
+        std::condition_variable cv;
+    };
+
+    // The pointers to the N vectors, one per task. Once initialized,
+    // before the DAG execution, this information is CONSTANT (refers back
+    // to each Edge)
+    std::array<void *, RTDAG_MAX_TASKS> buffers;
+
+    size_t inputs;
+
+    // At least one, the originator has no inputs but is released by the
+    // sink through its queue
+    size_t predecessors;
+
+    // Number of elements each predecessor can push before blocking
+    size_t depth;
+
+    // Mutex to lock to access the multi queue
+    alignas(cache_line_size) std::mutex mtx;
+
+    // Number of predecessors that have completed execution, one counter
+    // per DAG instance that can be in flight
+    std::array<size_t, RTDAG_MAX_INFLIGHT> arrived;
+
+    // The cell the consumer will pop next
+    size_t tail = 0;
+
+    // The consumer waits on this variable
+    std::condition_variable cv_successor;
+
+    std::array<producer, RTDAG_MAX_TASKS> producers;
+
+    inline size_t num_predecessors() {
+        return predecessors;
+    }
+
+    // NOTICE: the lock MUST be held before calling this function
+    inline bool all_arrived() {
+        return arrived[tail] == num_predecessors();
+    }
+
+    static inline void check_policy(wait_policy policy) {
+        if (policy != wait_policy::BLOCK) {
+            throw std::logic_error(
+                "Only the block wait policy is supported by MultiQueue!");
+        }
+    }
+
+public:
+    MutexMultiQueue(size_t size, size_t depth = 1) :
+        inputs(size),
+        predecessors(size == 0 ? 1 : size),
+        depth(depth) {
+        if (size > mask_type().size()) {
+            throw std::logic_error(
+                "Exceeded maximum size for the multiqueue! Too many tasks!");
+        }
+        if (depth < 1 || depth > arrived.size()) {
+            throw std::logic_error("Invalid depth for the multiqueue!");
+        }
+        buffers.fill(nullptr);
+        arrived.fill(0);
+    }
+
+    size_t size(void) {
+        return inputs;
+    }
+
+    // Only blocking waits on the condition variables are supported
+    void set_consumer_policy(wait_policy policy) {
+        check_policy(policy);
+    }
+
+    void set_producer_policy(size_t i, wait_policy policy) {
+        (void)i;
+        check_policy(policy);
+    }
+
+    void set_spin_limit(nanoseconds limit) {
+        (void)limit;
+    }
+
+    // May block if the i-th elem is busy; returns 1 if all
+    // elems have been pushed as input to target (so it has
+    // been notified)
+    inline bool push(size_t i) {
+        if (i >= num_predecessors()) {
+            throw std::logic_error("Accessed oob bit in MultiQueue!");
+        }
+
+        producer &self = producers[i];
+        std::unique_lock<std::mutex> lock(mtx);
+
+        while (self.pending == depth) {
+            self.waiting++;
+            LOG_DEBUG("push() suspending...\n");
+            self.cv.wait(lock);
+            LOG_DEBUG("push() woken up...\n");
+            self.waiting--;
+        }
+
+        size_t cell = self.head;
+        self.head = (cell + 1) % depth;
+        self.pending++;
+
+        if (++arrived[cell] == num_predecessors()) {
+            // Wakeup whoever is waiting
+            cv_successor.notify_one();
+            return true;
+        }
+
+        // No notification
+        return false;
+    }
+
+    inline void pop() {
+        std::unique_lock<std::mutex> lock(mtx);
+
+        while (!all_arrived()) {
+            LOG_DEBUG("pop() suspending...\n");
+            cv_successor.wait(lock);
+            LOG_DEBUG("pop() woken up...\n");
+        }
+
+        arrived[tail] = 0;
+        tail = (tail + 1) % depth;
+
+        // Well done, now wake up everyone
+        for (size_t i = 0; i < num_predecessors(); ++i) {
+            producer &p = producers[i];
+            p.pending--;
+            if (p.waiting > 0) {
+                p.cv.notify_one();
+            }
+        }
+    }
+
+    void set_buffer(size_t index, void *buffer) {
+        if (index >= num_predecessors()) {
+            throw std::logic_error("Accessed oob bit in MultiQueue!");
+        }
+
+        buffers[index] = buffer;
+    }
+};
+
+#endif // RTDAG_MQUEUE_MUTEX_H
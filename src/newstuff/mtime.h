@@ -15,6 +15,13 @@ static inline struct timespec curtime() {
     return time;
 }
 
+// CPU time of the calling thread, it does not advance while preempted
+static inline struct timespec thread_cputime() {
+    struct timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time;
+}
+
 static inline struct timespec operator-(const struct timespec &t1,
                                         const struct timespec &t0) {
     struct timespec diff = {
@@ -0,0 +1,147 @@
+#include "newstuff/numa.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "logging.h"
+
+std::optional<numa_placement> numa_placement_from_string(const std::string &s) {
+    if (s == "none") {
+        return numa_placement::NONE;
+    }
+    if (s == "consumer") {
+        return numa_placement::CONSUMER;
+    }
+    if (s == "producer") {
+        return numa_placement::PRODUCER;
+    }
+    return std::nullopt;
+}
+
+// Node of each CPU, as read from /sys/devices/system/node/node*/cpulist
+static const std::vector<int> &cpu_to_node() {
+    static const std::vector<int> nodes = []() {
+        std::vector<int> v;
+
+        for (int node = 0;; ++node) {
+            std::ifstream f("/sys/devices/system/node/node" +
+                            std::to_string(node) + "/cpulist");
+            if (!f) {
+                break;
+            }
+
+            // Comma-separated list of CPUs or ranges, like "0-3,8-11"
+            std::string range;
+            while (std::getline(f, range, ',')) {
+                int first, last;
+                char dash;
+                std::istringstream ss(range);
+                if (!(ss >> first)) {
+                    continue;
+                }
+                last = (ss >> dash >> last) ? last : first;
+
+                if (last >= int(v.size())) {
+                    v.resize(last + 1, -1);
+                }
+                for (int cpu = first; cpu <= last; ++cpu) {
+                    v[cpu] = node;
+                }
+            }
+        }
+
+        return v;
+    }();
+
+    return nodes;
+}
+
+int numa_nodes() {
+    int max_node = -1;
+    for (int node : cpu_to_node()) {
+        max_node = std::max(max_node, node);
+    }
+    return max_node < 0 ? 1 : max_node + 1;
+}
+
+int numa_node_of_cpu(int cpu) {
+    const auto &nodes = cpu_to_node();
+    if (cpu < 0 || cpu >= int(nodes.size())) {
+        return -1;
+    }
+    return nodes[cpu];
+}
+
+int numa_node_of_address(const void *addr) {
+    const long page = sysconf(_SC_PAGESIZE);
+    void *pages[1] = {
+        reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(addr) & ~(page - 1))};
+    int status[1] = {-1};
+
+    // With no target nodes, move_pages() only reports where pages are
+    if (syscall(SYS_move_pages, 0, 1, pages, nullptr, status, 0) < 0) {
+        return -1;
+    }
+    return status[0] < 0 ? -1 : status[0];
+}
+
+// Mask with only the given node set, as expected by mbind() and
+// set_mempolicy(), empty if the node does not exist
+static std::vector<unsigned long> node_mask(int node) {
+    constexpr int bits = sizeof(unsigned long) * 8;
+
+    const int nodes = numa_nodes();
+    if (node < 0 || node >= nodes) {
+        LOG(WARNING, "Invalid NUMA node %d, the system has %d\n", node, nodes);
+        return {};
+    }
+
+    std::vector<unsigned long> mask((nodes + bits - 1) / bits, 0);
+    mask[node / bits] |= 1ul << (node % bits);
+    return mask;
+}
+
+// The kernel ignores the last bit of the mask it is given (maxnode - 1
+// bits are read), hence the + 1
+static unsigned long max_node(const std::vector<unsigned long> &mask) {
+    return mask.size() * sizeof(unsigned long) * 8 + 1;
+}
+
+bool numa_bind(void *addr, size_t len, int node) {
+    const auto mask = node_mask(node);
+    if (mask.empty()) {
+        return false;
+    }
+
+    if (syscall(SYS_mbind, addr, len, MPOL_BIND, mask.data(), max_node(mask),
+                MPOL_MF_MOVE) < 0) {
+        LOG(WARNING, "mbind() on node %d failed: %s\n", node,
+            std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool numa_prefer(int node) {
+    const auto mask = node_mask(node);
+    if (mask.empty()) {
+        return false;
+    }
+
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.data(),
+                max_node(mask)) < 0) {
+        LOG(WARNING, "set_mempolicy() on node %d failed: %s\n", node,
+            std::strerror(errno));
+        return false;
+    }
+    return true;
+}
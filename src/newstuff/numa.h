@@ -0,0 +1,39 @@
+#ifndef RTDAG_NUMA_H
+#define RTDAG_NUMA_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+// Where the memory shared on each edge (buffers and queue state) is placed
+enum class numa_placement {
+    NONE,     // wherever the main thread touches it first
+    CONSUMER, // on the node of the CPU of the consumer task
+    PRODUCER, // on the node of the CPU of the producer task
+};
+
+std::optional<numa_placement> numa_placement_from_string(const std::string &s);
+
+// Minimal NUMA support, without depending on libnuma: the topology is read
+// from sysfs and memory policies are set directly with system calls.
+
+// Number of NUMA nodes of the system (1 if NUMA is not supported)
+int numa_nodes();
+
+// The node of the given CPU, -1 if unknown
+int numa_node_of_cpu(int cpu);
+
+// The node on which the page containing addr currently resides, -1 if
+// unknown (e.g., the page was never touched)
+int numa_node_of_address(const void *addr);
+
+// Binds the pages in [addr, addr + len) to the given node, moving them if
+// they have already been touched. addr MUST be page-aligned. Returns false
+// (with a warning) on failure or if the node does not exist.
+bool numa_bind(void *addr, size_t len, int node);
+
+// Makes the calling thread allocate its memory on the given node first
+// (false, with a warning, as above)
+bool numa_prefer(int node);
+
+#endif // RTDAG_NUMA_H
@@ -0,0 +1,186 @@
+#include "newstuff/perf.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "logging.h"
+
+struct perf_event_config {
+    u32 type;
+    u64 config;
+};
+
+static constexpr perf_event_config perf_events[PERF_NUM_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+};
+
+// Counts the calling thread on any CPU, returns -1 on failure
+static int perf_open(const perf_event_config &event, int group_fd) {
+    struct perf_event_attr attr = {};
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_hv = 1;
+
+    int fd = syscall(SYS_perf_event_open, &attr, 0, -1, group_fd,
+                     PERF_FLAG_FD_CLOEXEC);
+    if (fd < 0 && errno == EACCES) {
+        // Unprivileged users may be allowed to count user space only
+        attr.exclude_kernel = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, group_fd,
+                     PERF_FLAG_FD_CLOEXEC);
+    }
+    return fd;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline u64 rdpmc(u32 counter) {
+    u32 low, high;
+    asm volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(counter));
+    return u64(high) << 32 | low;
+}
+#endif
+
+PerfCounters::PerfCounters() {
+    for (int &fd : fds) {
+        fd = -1;
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+void PerfCounters::open(const std::string &who) {
+    const size_t page = sysconf(_SC_PAGESIZE);
+
+    for (int i = 0; i < PERF_NUM_COUNTERS; ++i) {
+        const bool leader = i == PERF_CYCLES || i == PERF_TASK_CLOCK;
+        const int group_fd = i < PERF_TASK_CLOCK ? fds[PERF_CYCLES]
+                                                 : fds[PERF_TASK_CLOCK];
+        if (!leader && group_fd < 0) {
+            // The whole group is missing, already reported
+            continue;
+        }
+
+        fds[i] = perf_open(perf_events[i], leader ? -1 : group_fd);
+        if (fds[i] < 0) {
+            if (i == PERF_CYCLES) {
+                LOG(WARNING,
+                    "task %s: hardware counters not available (%s), "
+                    "recording software ones only\n",
+                    who.c_str(), std::strerror(errno));
+            } else {
+                LOG(WARNING, "task %s: counter %s not available: %s\n",
+                    who.c_str(), perf_counter_names[i], std::strerror(errno));
+            }
+            continue;
+        }
+
+        if (i < PERF_TASK_CLOCK) {
+            void *addr = mmap(nullptr, page, PROT_READ, MAP_SHARED, fds[i], 0);
+            pages[i] = addr == MAP_FAILED ? nullptr : addr;
+        }
+    }
+}
+
+void PerfCounters::close() {
+    const size_t page = sysconf(_SC_PAGESIZE);
+
+    for (int i = 0; i < PERF_NUM_COUNTERS; ++i) {
+        if (i < PERF_TASK_CLOCK && pages[i]) {
+            munmap(pages[i], page);
+            pages[i] = nullptr;
+        }
+
+        if (fds[i] >= 0) {
+            ::close(fds[i]);
+            fds[i] = -1;
+        }
+    }
+}
+
+bool PerfCounters::read_group(perf_sample &s, int first, int last) const {
+    if (fds[first] < 0) {
+        return false;
+    }
+
+    // Number of values, then the values in the order they were opened
+    u64 values[1 + PERF_NUM_COUNTERS];
+    if (::read(fds[first], values, sizeof(values)) < ssize_t(sizeof(u64))) {
+        return false;
+    }
+
+    u64 j = 1;
+    for (int i = first; i <= last; ++i) {
+        if (fds[i] >= 0 && j <= values[0]) {
+            s.count[i] = values[j++];
+        }
+    }
+    return true;
+}
+
+// Follows the protocol described in linux/perf_event.h: the counter is read
+// from the PMU and added to the offset kept by the kernel, retrying if the
+// kernel updated the page meanwhile. Fails if the counters are not on the
+// PMU right now or the kernel does not allow rdpmc.
+bool PerfCounters::read_rdpmc(perf_sample &s) const {
+#if defined(__x86_64__) || defined(__i386__)
+    for (int i = 0; i < num_hw; ++i) {
+        if (fds[i] < 0) {
+            continue;
+        }
+
+        const volatile auto *pc =
+            static_cast<const volatile perf_event_mmap_page *>(pages[i]);
+        if (!pc) {
+            return false;
+        }
+
+        u32 seq;
+        u64 count;
+        do {
+            seq = pc->lock;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+
+            const u32 index = pc->index;
+            if (!pc->cap_user_rdpmc || index == 0) {
+                return false;
+            }
+
+            // Sign-extend the counter to 64 bits
+            const u32 shift = 64 - pc->pmc_width;
+            const s64 pmc = s64(rdpmc(index - 1) << shift) >> shift;
+            count = pc->offset + pmc;
+
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        } while (pc->lock != seq);
+
+        s.count[i] = count;
+    }
+    return true;
+#else
+    (void)s;
+    return false;
+#endif
+}
+
+void PerfCounters::read(perf_sample &s) const {
+    if (has_hardware() && !read_rdpmc(s)) {
+        read_group(s, PERF_CYCLES, PERF_TASK_CLOCK - 1);
+    }
+    read_group(s, PERF_TASK_CLOCK, PERF_NUM_COUNTERS - 1);
+}
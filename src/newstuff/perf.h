@@ -0,0 +1,86 @@
+#ifndef RTDAG_PERF_H
+#define RTDAG_PERF_H
+
+#include <string>
+
+#include "newstuff/integers.h"
+
+// Performance counters of a task, opened with perf_event_open on the thread
+// of the task itself and sampled around the work of each job.
+//
+// The hardware counters are in one group, read with rdpmc from user space
+// whenever the kernel allows it (read(2) otherwise); the software ones are
+// in another group, read with read(2). Without a hardware PMU (e.g., in most
+// VMs) only the software counters are recorded, the others stay 0.
+
+enum perf_counter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_TASK_CLOCK, // ns
+    PERF_CONTEXT_SWITCHES,
+    PERF_CPU_MIGRATIONS,
+    PERF_NUM_COUNTERS,
+};
+
+constexpr const char *perf_counter_names[PERF_NUM_COUNTERS] = {
+    "cycles",        "instructions",     "llc_misses",     "branch_misses",
+    "task_clock_ns", "context_switches", "cpu_migrations",
+};
+
+// Counters of one job (or absolute values, while sampling)
+struct perf_sample {
+    u64 count[PERF_NUM_COUNTERS];
+};
+
+class PerfCounters {
+    static constexpr int num_hw = PERF_TASK_CLOCK;
+    static constexpr int num_sw = PERF_NUM_COUNTERS - PERF_TASK_CLOCK;
+
+    // Indexed by counter, -1 if not available (the first one of each group
+    // is its leader)
+    int fds[PERF_NUM_COUNTERS];
+
+    // The mapped control page of each hardware counter, used for rdpmc
+    void *pages[num_hw] = {};
+
+    // Values at the beginning of the current job
+    perf_sample start = {};
+
+    // Reads the group led by the first counter into the counters up to the
+    // last one, skipping the ones that could not be opened
+    bool read_group(perf_sample &s, int first, int last) const;
+    bool read_rdpmc(perf_sample &s) const;
+    void read(perf_sample &s) const;
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    // Opens the counters of the calling thread, warning if the hardware
+    // ones are not available (which is not an error)
+    void open(const std::string &who);
+    void close();
+
+    bool has_hardware() const {
+        return fds[PERF_CYCLES] >= 0;
+    }
+
+    void begin() {
+        read(start);
+    }
+
+    // Counters since the last begin
+    void end(perf_sample &delta) {
+        read(delta);
+        for (int i = 0; i < PERF_NUM_COUNTERS; ++i) {
+            delta.count[i] -= start.count[i];
+        }
+    }
+};
+
+#endif // RTDAG_PERF_H
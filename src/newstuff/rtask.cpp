@@ -3,13 +3,18 @@
 #include "periodic_task.h"
 #include <string_view>
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
 #include <cstring>
 #include <fstream>
 #include <istream>
 #include <ostream>
 #include <span>
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 // ------------------------- HELPER FUNCTIONS -------------------------- //
 
 static inline void task_set_name(const std::string_view &sname) {
@@ -26,13 +31,15 @@ static inline void task_set_name(const std::string_view &sname) {
     };
 }
 
+#if RTDAG_TASK_IMPL == TASK_IMPL_PROCESS
+static inline int task_pin_process(const cpu_set_t &cpuset) {
+    return sched_setaffinity(getpid(), sizeof(cpuset), &cpuset);
+}
+#else
 static inline int task_pin_thread(const cpu_set_t &cpuset) {
     return pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
 }
-
-// static inline int task_pin_process(const cpu_set_t &cpuset) {
-//     return sched_setaffinity(getpid(), sizeof(cpuset), &cpuset);
-// }
+#endif
 
 static inline void task_pin(int cpu) {
     cpu_set_t cpuset;
@@ -40,7 +47,11 @@ static inline void task_pin(int cpu) {
     CPU_ZERO(&cpuset);
     CPU_SET(cpu, &cpuset);
 
+#if RTDAG_TASK_IMPL == TASK_IMPL_PROCESS
+    if (int res = task_pin_process(cpuset)) {
+#else
     if (int res = task_pin_thread(cpuset)) {
+#endif
         (void)res;
         LOG(ERROR, "Could not pin to core %d!\n", cpu);
         exit(EXIT_FAILURE);
@@ -68,30 +79,170 @@ static inline void task_pin(int cpu) {
 
 // ------------------------- MEMBER FUNCTIONS -------------------------- //
 
+#if RTDAG_TASK_IMPL == TASK_IMPL_PROCESS
+
+int Task::start(int seed) {
+    // Anything still buffered would be printed by the child too
+    fflush(nullptr);
+
+    pid = fork();
+    if (pid < 0) {
+        LOG(ERROR, "Could not fork task %s: %s\n", name.c_str(),
+            strerror(errno));
+        return -1;
+    }
+
+    if (pid == 0) {
+        // The stack of the child is the one of the main thread, it grows
+        // on demand up to the limit
+        if (dag.startup.stack_size > 0) {
+            set_stack_limit(dag.startup.stack_size);
+        }
+
+        // All the shared state lives in the arena, mapped before forking,
+        // hence it is at the same address in the child
+        task_body(seed);
+        exit(EXIT_SUCCESS);
+    }
+
+    return 0;
+}
+
+void Task::wait(void) {
+    int status;
+    if (waitpid(pid, &status, 0) < 0) {
+        LOG(ERROR, "Could not wait for task %s: %s\n", name.c_str(),
+            strerror(errno));
+        return;
+    }
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        LOG(ERROR, "Task %s terminated abnormally (status %d)\n",
+            name.c_str(), status);
+    }
+}
+
+#else
+
+int Task::start(int seed) {
+    // Started with pthreads, std::thread does not allow to set the stack
+    // size
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (dag.startup.stack_size > 0) {
+        pthread_attr_setstacksize(&attr, dag.startup.stack_size);
+    }
+
+    this->seed = seed;
+    const auto body = [](void *arg) -> void * {
+        Task *task = static_cast<Task *>(arg);
+        task->task_body(task->seed);
+        return nullptr;
+    };
+
+    const int res = pthread_create(&th_handle, &attr, body, this);
+    pthread_attr_destroy(&attr);
+
+    if (res != 0) {
+        LOG(ERROR, "Could not start task %s: %s\n", name.c_str(),
+            strerror(res));
+        return -1;
+    }
+
+    return 0;
+}
+
+void Task::wait(void) {
+    pthread_join(th_handle, nullptr);
+}
+
+#endif
+
 void Task::task_body(unsigned seed) {
     (void)seed; // FIXME: pass it to the other functions
 
+    // Pinned before initializing, so that the private data of the task is
+    // allocated on its own node
+    task_set_name(name);
+
+    if (cpu >= 0) {
+        task_pin(cpu);
+
+        const int node = numa_node_of_cpu(cpu);
+        if (dag.placement != numa_placement::NONE && node >= 0) {
+            numa_prefer(node);
+        }
+    }
+
+    // Startup phase: anything that may fault is done before the first
+    // barrier, the code paths are warmed up by the warm-up activations
+    if (dag.startup.lock_memory) {
+        lock_memory();
+    }
+
+    if (dag.startup.stack_size > 0) {
+        prefault_stack(dag.startup.stack_size);
+    }
+
+#if RTDAG_TASK_IMPL == TASK_IMPL_PROCESS
+    // fork() does not copy the page tables of shared mappings: the arena
+    // prefaulted by the parent must be populated in each child as well
+    dag.arena.prefault();
+#endif
+
     do_init();
     common_init();
 
-    for (int i = 0; i < dag.num_activations; ++i) {
+    for (int i = 0; i < dag.num_jobs(); ++i) {
         struct timespec before, after, duration;
 
         loop_body_before(i);
+#if RTDAG_PERF_COUNTERS == ON
+        perf.begin();
+#endif
+        if (dag.ftrace) {
+            dag.ftrace->mark("rtdag B %s %d", name.c_str(), i);
+        }
         before = curtime();
 
         do_loop_work(i);
         after = curtime();
         duration = after - before;
+        if (dag.ftrace) {
+            dag.ftrace->mark("rtdag E %s %d", name.c_str(), i);
+        }
+#if RTDAG_PERF_COUNTERS == ON
+        perf.end(records.get_sample(i));
+#endif
+
+        job_record &rec = records.get(i);
+        rec.start = to_record_time(before);
+        rec.end = to_record_time(after);
+
+        if (i >= dag.startup.warmup_activations) {
+            exec_hist.record(to_nanoseconds(duration).count());
+        }
 
         loop_body_after(i, duration);
+
+        if (live && i >= dag.startup.warmup_activations) {
+            live_stats.jobs++;
+            live_stats.max_exec_ns = std::max<u64>(
+                live_stats.max_exec_ns, to_nanoseconds(duration).count());
+            live_stats.deadline_misses = response_hist.deadline_misses();
+            live_stats.max_lateness_ns = response_hist.max_lateness();
+            live->stats.write(live_stats);
+        }
     }
 
     common_exit();
+    if (dag.results == results_format::TEXT) {
+        dump_records();
+    }
     do_exit();
 }
 
-void wait_on_barrier(std::barrier<> &barrier, const std::string &who) {
+void wait_on_barrier(DagBarrier &barrier, const std::string &who) {
     // wait for all threads in the DAG to have been started up to this point
     LOG(DEBUG, "barrier_wait()ing on: %p for task %s\n", (void *)&barrier,
         who.c_str());
@@ -121,13 +272,18 @@ void align_deadlines(period_info &pinfo) {
 }
 
 void Task::common_init() {
-    task_set_name(name);
+    // task_clean_buffers(data);
 
-    if (cpu >= 0) {
-        task_pin(cpu);
-    }
+#if RTDAG_MEM_ACCESS == ON
+    // Allocated (and touched) here, in the memory local to the task
+    traffic.assign(dag.kept_jobs(), mem_traffic{});
+#endif
 
-    // task_clean_buffers(data);
+#if RTDAG_PERF_COUNTERS == ON
+    // Counters of this thread (or process), opened before the first job
+    perf.open(name);
+    records.hardware_samples = perf.has_hardware();
+#endif
 
     scheduling.set();
 
@@ -150,12 +306,12 @@ struct timespec get_next_period(struct period_info *pinfo) {
 
 #if RTDAG_MEM_ACCESS == ON
 // used to mimic the buffer memory reads
-static char read_input_buffer(std::span<char> buffer) {
-    char checksum = 0;
-    for (unsigned i = 0; i < buffer.size(); ++i) {
-        checksum ^= buffer[i];
-    }
-    return checksum;
+static char read_input_buffer(std::span<const u8> buffer) {
+    u64 checksum = mem_reduce(buffer);
+    checksum ^= checksum >> 32;
+    checksum ^= checksum >> 16;
+    checksum ^= checksum >> 8;
+    return char(checksum);
 }
 #endif
 
@@ -165,26 +321,26 @@ void wait_incoming_messages(Task &task, int iter) {
         // can just wait on the first one
         task.in_mq.pop();
 
+        mem_traffic &traffic = task.job_traffic(iter);
+
         // Check that all the buffers have sent the right amount of data
-        for (size_t i = 0; i < task.in_mq.size(); ++i) {
+        for (Edge *edge : task.in_buffers) {
+            std::span<u8> msg = edge->receive(iter, traffic);
+
             // NOTE: CHECKED ONLY IN DEBUG MODE
-            // assert(strlen(task.in_buffers[i]->msg.data()) ==
-            //        (size_t) task.in_buffers[i]->msg.size() - 1);
+            // assert(strlen((char *)msg.data()) == msg.size() - 1);
 
 #if RTDAG_MEM_ACCESS == ON
             // This is a dummy code (a checksum calculation w xor) to
             // mimic the memory reads required by the task model
-            task.checksum ^= read_input_buffer(task.in_buffers[i]->msg);
+            task.checksum = task.checksum ^ read_input_buffer(msg);
+            traffic.read += msg.size();
 #endif
 
-	    (void)iter;
             // To avoid printing too many characters if the buffer is very
             // long, we limit to the first 50 characters.
-            //LOG(DEBUG,
-            //    "task %s (%u), buffer nxxx_nyyy(%lu): got message: '%.50s'\n",
-            //    task.name.c_str(), iter,
-            //    strlen((char *)task.in_buffers[i]->msg.data()),
-            //    task.in_buffers[i]->msg.data());
+            LOG(DEBUG, "task %s (%u), buffer n%d_n%d: got message: '%.50s'\n",
+                task.name.c_str(), iter, edge->from, edge->to, msg.data());
         }
     }
 }
@@ -194,96 +350,176 @@ void Task::loop_body_before(int iter) {
     // and read at the end of each period by the sink, to calculate overall
     // response time.
 
+    job_record &rec = records.begin(iter);
+
     if (is_originator()) {
         // Wait for the sink to release this task
         dag.start_dag->pop();
 
-        dag.start_time = get_next_period(&pinfo);
+        // Once asked to stop, this is the last instance released: the ones
+        // in flight drain through the DAG, then all the tasks are done
+        if (dag.control.stop_requested.load(std::memory_order_relaxed)) {
+            dag.stop_after(iter);
+        }
+
+        struct timespec &start_time = dag.start_time(iter);
+        start_time = get_next_period(&pinfo);
 
         LOG(DEBUG, "task %s (%u): dag start time " TIMESPEC_FORMAT "\n",
-            name.c_str(), iter, dag.start_time.tv_sec, dag.start_time.tv_nsec);
+            name.c_str(), iter, start_time.tv_sec, start_time.tv_nsec);
+
+        // The measured window begins with the release of this instance
+        if (dag.ftrace && iter == dag.startup.warmup_activations) {
+            dag.ftrace->start();
+        }
     }
 
     wait_incoming_messages(*this, iter);
+    JobRecords::stamp(rec.wakeup);
+
+    // Written by the originator before releasing the instance, it cannot
+    // change until the sink is done with it
+    rec.release = to_record_time(dag.start_time(iter));
 }
 
-void write_to_queue(const char *from, int iter, char *buffer, int size) {
+// Returns the number of bytes written
+size_t write_to_queue(const char *from, int iter, std::span<u8> buffer) {
 #if RTDAG_MEM_ACCESS != ON
     (void)from;
     (void)iter;
     (void)buffer;
-    (void)size;
+    return 0;
 #else
+    // The whole message is streamed, with a printable value that changes at
+    // each iteration
+    mem_fill(buffer, 'a' + iter % 26);
+
+#if RTDAG_LOG_LEVEL >= LOG_LEVEL_DEBUG
     // The printf helps debug from which task writes where, but it is a
-    // performance penalty compared to simply using memcpy or memset.
-    // Consider replacing with those if you experience performance issues
-    // in this step.
-
-    int len =
-        (int)snprintf(buffer, size, "Message from %s, iter: %d", from, iter);
-    if (len < size) {
-        memset(buffer + len, '.', size - len);
-        buffer[size - 1] = 0;
-    }
+    // performance penalty, hence it is done only in debug builds.
+    snprintf((char *)buffer.data(), buffer.size(), "Message from %s, iter: %d",
+             from, iter);
+#else
+    (void)from;
+#endif
+
+    buffer.back() = 0;
+    return buffer.size();
 #endif
 }
 
 void Task::loop_body_after(int iter, const struct timespec &duration) {
     (void)duration;
-    // Push the values into each queue
-    for (size_t i = 0; i < out_buffers.size(); ++i) {
-        write_to_queue(name.c_str(), iter, (char *)out_buffers[i]->msg.data(),
-                       out_buffers[i]->msg.size());
 
-        // The values pushed in the multi-queue are meaningless, on the
-        // read side we always go check the ->msg content anyway...
-        out_buffers[i]->mq.push(out_buffers[i]->push_idx);
+    // The input messages are not needed anymore
+    for (Edge *edge : in_buffers) {
+        edge->release();
+    }
+
+    mem_traffic &traffic = job_traffic(iter);
+
+    // Push the values into each queue
+    for (Edge *edge : out_buffers) {
+        std::span<u8> msg = edge->loan(iter);
+        traffic.written += write_to_queue(name.c_str(), iter, msg);
 
         // To avoid printing too many characters if the buffer is very
-        // long, we limit to the first 50 characters.
+        // long, we limit to the first 50 characters (logged before
+        // publishing, the message belongs to the consumer after that)
         LOG(DEBUG,
             "task %s (%u): buffer n%d_n%d, size %lu, sent message: '%.50s'\n",
-            name.c_str(), iter, out_buffers[i]->from, out_buffers[i]->to,
-            strlen((char *)out_buffers[i]->msg.data()),
-            out_buffers[i]->msg.data());
+            name.c_str(), iter, edge->from, edge->to,
+            strlen((char *)msg.data()), msg.data());
+
+        live_stats.push_ns += edge->publish(iter, traffic).count();
+
+        if (dag.ftrace) {
+            dag.ftrace->mark("rtdag S %d %d %d", edge->from, edge->to, iter);
+        }
     }
 
-#ifndef NDEBUG
-    // FIXME: implement this stuff as well
-
-    // write the task execution time into its log file
-    // exec_time_f << duration << std::endl;
-    // if (duration > task.deadline) {
-    //     printf("ERROR: task %s (%u): task duration %lu > deadline %lu!\n",
-    //            task_name, iter, duration, task.deadline);
-    //     // TODO: stop or continue ?
-    // }
-#else
-    (void)duration;
-#endif // NDEBUG
+    // Warm-up activations are not measured
+    const s64 measured = iter - dag.startup.warmup_activations;
+
+    job_record &rec = records.get(iter);
 
     if (is_sink()) {
-        struct timespec dag_duration = curtime() - dag.start_time;
+        // The instance is complete: the sink has no pushes of its own, the
+        // one to the originator below belongs to the next instance
+        const struct timespec now = curtime();
+        struct timespec dag_duration = now - dag.start_time(iter);
+        rec.pushed = to_record_time(now);
 
         LOG(INFO, "task %s (%u): dag dag_duration " TIMESPEC_FORMAT " s\n",
             name.c_str(), iter, dag_duration.tv_sec, dag_duration.tv_nsec);
 
         microseconds mduration = to_duration_truncate<microseconds>(dag_duration);
+        const u64 ns = to_nanoseconds(dag_duration).count();
+        const bool miss = measured >= 0 && dag.misses_deadline(ns);
+
+        if (measured >= 0) {
+            dag.response_time(measured) = mduration;
+            dag.missed(measured) = miss;
+            dag.response_hist.record(ns);
+
+            if (dag.stream) {
+                dag.stream->record(ns, to_record_time(now));
+            }
+
+            if (dag.live) {
+                live_dag.activations++;
+                live_dag.misses += miss;
+                live_dag.last_response_ns = ns;
+                live_dag.max_response_ns =
+                    std::max(live_dag.max_response_ns, ns);
+                dag.live->write(live_dag);
+            }
+        }
 
-        dag.response_times[iter] = mduration;
-
-        if (mduration > dag.e2e_deadline) {
+        if (miss) {
             // we do expect a few deadline misses, despite all
             // precautions, we'll find them in the output file
             LOG(ERROR,
                 "ERROR: dag deadline violation detected in iteration "
                 "%u. duration %ld us\n",
                 iter, mduration.count());
+
+            if (dag.ftrace) {
+                dag.ftrace->mark("rtdag M %d %ld", iter, mduration.count());
+                dag.ftrace->snapshot();
+            }
+        }
+
+        // The measured window ends with the last instance
+        if (iter == dag.num_jobs() - 1) {
+            if (dag.ftrace) {
+                dag.ftrace->stop();
+            }
+            if (dag.stream) {
+                dag.stream->finish();
+            }
         }
 
         // Signal the first task that it can start once again (after the
-        // period wait elapsed)
+        // period wait elapsed), there is one less instance in flight
+        const struct timespec before = curtime();
         dag.start_dag->push(0);
+        live_stats.push_ns += to_nanoseconds(curtime() - before).count();
+    } else {
+        JobRecords::stamp(rec.pushed);
+    }
+
+    JobRecords::stamp_cpu(rec.cpu);
+
+    // Deadline of the task, checked against its own release: when the last
+    // of its predecessors published this instance to it (like the critical
+    // paths of the blame report)
+    if (measured >= 0) {
+        s64 release = rec.release;
+        for (const Edge *edge : in_buffers) {
+            release = std::max(release, edge->published_time(iter));
+        }
+        response_hist.record(rec.pushed - release);
     }
 
     if (is_originator()) {
@@ -315,7 +551,12 @@ void Task::common_exit() {
     // exec_time_f.close();
 #endif // NDEBUG
 
-    if (is_sink()) {
+#if RTDAG_PERF_COUNTERS == ON
+    perf.close();
+#endif
+
+    // Otherwise saved by the main process
+    if (is_sink() && dag.results == results_format::TEXT) {
         // FIXME: change this to avoid creating the output directory
         std::stringstream ss;
         ss << dag.name << "/" << dag.name << ".log";
@@ -328,8 +569,8 @@ void Task::common_exit() {
             os << dag.e2e_deadline << '\n';
         }
 
-        for (const auto &rt : dag.response_times) {
-            os << rt.count() << "\n";
+        for (s64 m = dag.first_kept(); m < dag.num_measured(); ++m) {
+            os << dag.response_time(m).count() << "\n";
         }
     }
 
@@ -341,9 +582,34 @@ void Task::common_exit() {
     // variable is volatile.
     //
     printf("%c\n", checksum);
+
+    // One line per job: bytes read and written on the edges
+    std::stringstream ss;
+    ss << dag.name << "/" << name << ".mem.log";
+
+    bool existed;
+    std::fstream os = open_append(ss.str(), existed);
+    const s64 njobs = dag.num_jobs();
+    for (s64 i = std::max<s64>(dag.startup.warmup_activations,
+                                njobs - s64(traffic.size()));
+         i < njobs; ++i) {
+        const mem_traffic &t = traffic[i % traffic.size()];
+        os << t.read << " " << t.written << "\n";
+    }
 #endif
 }
 
+void Task::dump_records() {
+    std::stringstream ss;
+    ss << dag.name << "/" << name << ".jobs.log";
+
+    // One line per measured job: iteration, then release, wake-up, start,
+    // end and push-complete times in ns, then the CPU
+    bool existed;
+    std::fstream os = open_append(ss.str(), existed);
+    records.dump(os, dag.startup.warmup_activations);
+}
+
 void Task::print(std::ostream &os) {
     os << name << ", ";
     os << "type: " << type << ", ";
@@ -351,15 +617,30 @@ void Task::print(std::ostream &os) {
     os << "deadline: " << scheduling.deadline().count() << "ns, ";
     os << "affinity: " << cpu << '\n';
 
-    //os << " ins: ";
-    //for (const auto &edge_ptr : in_buffers) {
-    //    os << "n" << edge_ptr->from << "_n" << edge_ptr->to << ", ";
-    //}
-    //os << '\n';
+    os << " ins: ";
+    for (const auto &edge_ptr : in_buffers) {
+        os << "n" << edge_ptr->from << "_n" << edge_ptr->to << ", ";
+    }
+    os << '\n';
 
     os << " outs: ";
     for (const auto &edge_ptr : out_buffers) {
         os << "n" << edge_ptr->from << "_n" << edge_ptr->to << ", ";
     }
     os << '\n';
+
+    if (dag.placement != numa_placement::NONE && cpu >= 0) {
+        const int node = numa_node_of_cpu(cpu);
+        const auto count_local = [node](const std::vector<Edge *> &edges) {
+            return std::count_if(edges.begin(), edges.end(), [node](Edge *e) {
+                return numa_node_of_address(e->msg.data()) == node;
+            });
+        };
+
+        os << " numa: node " << node << ", queue on node "
+           << numa_node_of_address(&in_mq) << ", local ins "
+           << count_local(in_buffers) << "/" << in_buffers.size()
+           << ", local outs " << count_local(out_buffers) << "/"
+           << out_buffers.size() << '\n';
+    }
 }
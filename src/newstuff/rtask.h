@@ -3,63 +3,261 @@
 
 #include <barrier>
 #include <chrono>
+#include <cmath>
+#include <limits>
+#include <span>
 #include <string>
-#include <thread>
 #include <vector>
 
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "newstuff/arena.h"
+#include "newstuff/ftrace.h"
+#include "newstuff/histogram.h"
+#include "newstuff/job_record.h"
+#include "newstuff/live.h"
 #include "newstuff/mqueue.h"
+#include "newstuff/numa.h"
+#include "newstuff/perf.h"
 #include "newstuff/schedutils.h"
+#include "newstuff/startup.h"
+#include "newstuff/stream.h"
+#include "newstuff/trace.h"
 #include "periodic_task.h"
 #include "rtdag_calib.h"
 #include "rtgauss.h"
 #include "time_aux.h"
 
+#if RTDAG_TASK_IMPL == TASK_IMPL_PROCESS
+// std::barrier cannot be shared among processes, use a pthread barrier
+// placed in shared memory instead
+class ProcessBarrier {
+    pthread_barrier_t bar;
+
+public:
+    ProcessBarrier(unsigned count) {
+        pthread_barrierattr_t attr;
+        pthread_barrierattr_init(&attr);
+        pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_barrier_init(&bar, &attr, count);
+        pthread_barrierattr_destroy(&attr);
+    }
+
+    ~ProcessBarrier() {
+        pthread_barrier_destroy(&bar);
+    }
+
+    ProcessBarrier(const ProcessBarrier &) = delete;
+    ProcessBarrier &operator=(const ProcessBarrier &) = delete;
+
+    void arrive_and_wait() {
+        pthread_barrier_wait(&bar);
+    }
+};
+
+using DagBarrier = ProcessBarrier;
+#else
+// For some reason I need to specify <>
+using DagBarrier = std::barrier<>;
+#endif
+
 class Dag {
 public:
     const std::string name;
     const microseconds period;
     const microseconds e2e_deadline;
+
+    // Measured activations, 0 to stream until stopped
     const s64 num_activations;
 
-    // For some reason I need to specify <>
-    std::barrier<> barrier;
+    // Number of the last activations whose response times and job records
+    // are kept in memory: all of them, unless streaming
+    const s64 window;
+
+    // Everything that is shared among tasks at runtime is allocated here
+    // (in shared memory when tasks are processes)
+    SharedArena &arena;
+
+    DagBarrier &barrier;
+
+    // Number of jobs, lowered when the run is stopped early
+    run_control &control;
 
     // One per task. The originator technically does not have any, but we
     // will use it to exchange the start time of the DAG with the sink
     // task.
     //
-    // Using unique_ptr because MultiQueue is not movable (due to
-    // std::mutex and other attributes), which is not possible as a vector
-    // element.
-    std::vector<std::unique_ptr<MultiQueue>> in_queues;
+    // Queues are allocated in the arena, because MultiQueue is not
+    // movable (due to std::mutex and other attributes) and it must be
+    // reachable by all the tasks.
+    std::vector<MultiQueue *> in_queues;
 
     // The edge connections between tasks (reference the in_queues above)
     std::vector<Edge> edges;
 
-    // Used to store the start time of the dag.
+    // Maximum number of DAG instances that can be in flight at the same
+    // time (1 means no pipelining)
+    const int max_inflight;
+
+    // Where the memory of each edge is placed (NONE if the system has a
+    // single NUMA node)
+    const numa_placement placement;
+
+    // Startup phase of each task, including the warm-up activations that
+    // are executed before the num_activations measured ones
+    const startup_info startup;
+
+    // How the response times and the job records are saved
+    const results_format results;
+
+    // Used to store the start time of each DAG instance in flight, indexed
+    // by the instance (iteration) number modulo max_inflight.
     //
     // NOTICE: this variable is NOT lock protected because ONLY THE DAG
-    // ORIGINATOR TASK WILL BE ABLE TO EXECUTE WHEN ACCESSED ON WRITE. All
-    // other tasks will be blocked waiting for the dag originator to wakeup
-    // and THE SINK TASK WILL WAKE UP THE ORIGINATOR AFTER FINISHING, so NO
-    // OVERLAP BETWEEN THE ORIGINATOR AND THE SINK IS POSSIBLE, hence the
+    // ORIGINATOR TASK WRITES IT, before pushing the corresponding instance
+    // down the DAG, and ONLY THE SINK TASK READS IT, after the instance
+    // went through the whole DAG. The originator cannot start (and
+    // overwrite the slot of) instance k + max_inflight until the sink has
+    // finished instance k and released it through start_dag, hence the
     // variable can be accessed freely without any (additional) lock.
-    struct timespec start_time;
+    std::span<struct timespec> start_times;
 
     // Used to release a new instance of the dag
     MultiQueue *start_dag;
 
-    // All the response times
-    std::vector<microseconds> response_times;
+    // The response times of the measured activations, in a ring of window
+    // slots (written by the sink)
+    std::span<microseconds> response_times;
+
+    // Whether each of those activations missed the deadline, decided once
+    // by the sink on the response time in ns (like the histogram below)
+    std::span<u8> misses;
+
+    // Histogram of the response times, in constant memory (written by the
+    // sink, printed by the main process at the end)
+    LatencyHistogram &response_hist;
+
+    // Live counters of the DAG, written by the sink (nullptr if disabled)
+    Seqlock<live_dag_stats> *live = nullptr;
+
+    // Where the tasks write their ftrace markers (nullptr if disabled)
+    Ftrace *ftrace = nullptr;
 
-    Dag(const std::string &name, microseconds period, microseconds e2e_deadline,
-        s64 num_activations, s32 ntasks) :
+    // Summaries of the intervals of a streaming run, written by the sink
+    // (nullptr unless streaming)
+    StreamStats *stream = nullptr;
+
+    Dag(SharedArena &arena, const std::string &name, microseconds period,
+        microseconds e2e_deadline, s64 num_activations, s64 window,
+        s32 ntasks, int max_inflight, numa_placement placement,
+        const startup_info &startup, results_format results) :
         name(name),
         period(period),
         e2e_deadline(e2e_deadline),
         num_activations(num_activations),
-        barrier(ntasks),
-        response_times(num_activations) {}
+        window(window),
+        arena(arena),
+        barrier(*arena.make<DagBarrier>(ntasks)),
+        control(*arena.make<run_control>(
+            num_activations > 0
+                ? startup.warmup_activations + num_activations
+                : std::numeric_limits<int>::max())),
+        max_inflight(max_inflight),
+        placement(placement),
+        startup(startup),
+        results(results),
+        start_times(arena.make_array<struct timespec>(max_inflight,
+                                                      cache_line_size)),
+        response_times(
+            arena.make_array<microseconds>(window, cache_line_size)),
+        misses(arena.make_array<u8>(window, cache_line_size)),
+        response_hist(*arena.make<LatencyHistogram>(
+            nanoseconds(e2e_deadline).count())) {}
+
+    struct timespec &start_time(int iter) {
+        return start_times[iter % max_inflight];
+    }
+
+    bool streaming() const {
+        return num_activations == 0;
+    }
+
+    // Total number of activations, warm-up included (the final one once
+    // the originator stopped)
+    s64 num_jobs() const {
+        return control.njobs.load(std::memory_order_relaxed);
+    }
+
+    // Makes the given activation the last one (originator only, before
+    // releasing it)
+    void stop_after(s64 iter) {
+        control.njobs.store(std::min(num_jobs(), iter + 1),
+                            std::memory_order_relaxed);
+    }
+
+    // Jobs of each task whose records are kept: all of them, warm-up
+    // included, unless streaming
+    s64 kept_jobs() const {
+        return streaming() ? window
+                           : startup.warmup_activations + num_activations;
+    }
+
+    // Measured activations, and the first one whose response time is still
+    // kept, once the tasks are done
+    s64 num_measured() const {
+        return std::max<s64>(0, num_jobs() - startup.warmup_activations);
+    }
+
+    s64 first_kept() const {
+        return std::max<s64>(0, num_measured() - window);
+    }
+
+    // The response time of the given measured activation, if kept
+    microseconds &response_time(s64 measured) {
+        return response_times[measured % window];
+    }
+
+    const microseconds &response_time(s64 measured) const {
+        return response_times[measured % window];
+    }
+
+    bool misses_deadline(u64 response_ns) const {
+        return response_ns > u64(nanoseconds(e2e_deadline).count());
+    }
+
+    // Whether the given measured activation missed the deadline, if kept
+    u8 &missed(s64 measured) {
+        return misses[measured % window];
+    }
+
+    bool missed(s64 measured) const {
+        return misses[measured % window];
+    }
+};
+
+// CPU time of the work of the jobs of a task with exec feedback, and how
+// many of them were out of tolerance on each side of the requested one (in
+// the arena, so that the main process can print them)
+struct cpu_time_stats {
+    const u64 requested_ns;
+    const u64 tolerance_ns;
+
+    LatencyHistogram hist;
+    u64 short_jobs = 0;
+    u64 long_jobs = 0;
+
+    cpu_time_stats(u64 requested_ns, u64 tolerance_ns) :
+        requested_ns(requested_ns), tolerance_ns(tolerance_ns) {}
+
+    void record(u64 ns) {
+        hist.record(ns);
+        if (ns + tolerance_ns < requested_ns) {
+            short_jobs++;
+        } else if (ns > requested_ns + tolerance_ns) {
+            long_jobs++;
+        }
+    }
 };
 
 class Task {
@@ -72,23 +270,79 @@ public:
     const int cpu;
 
     MultiQueue &in_mq;
+    std::vector<Edge *> in_buffers;
     std::vector<Edge *> out_buffers;
 
+    // Timestamps of each job, dumped at the end
+    JobRecords &records;
+
+    // Histogram of the execution times of the jobs (in the arena, so that
+    // the main process can print it)
+    LatencyHistogram &exec_hist;
+
+    // Histogram of the response times of the jobs, from the release of the
+    // task (the DAG release for the originator, the publish of the instance
+    // to it by its last predecessor for the others) to the end of its
+    // pushes, with the relative deadline of the task as threshold
+    LatencyHistogram &response_hist;
+
+    // CPU time of the work of the jobs (nullptr without feedback)
+    cpu_time_stats *cpu_times = nullptr;
+
+    // Live counters of the task (nullptr if disabled)
+    live_task *live = nullptr;
+
     period_info pinfo;
 
 #if RTDAG_MEM_ACCESS == ON
     // This volatile variable is used to avoid optimizing away all the
     // memory operations.
     volatile char checksum = 0;
+
+    // Bytes read and written on the edges by each job kept, in a ring like
+    // the job records
+    std::vector<mem_traffic> traffic;
+#endif
+
+#if RTDAG_PERF_COUNTERS == ON
+    // Opened by the task itself, sampled around the work of each job
+    PerfCounters perf;
 #endif
 
+    mem_traffic &job_traffic(int iter) {
+#if RTDAG_MEM_ACCESS == ON
+        return traffic[iter % traffic.size()];
+#else
+        // Nothing is moved, nothing is recorded
+        (void)iter;
+        return no_traffic;
+#endif
+    }
+
 private:
-    std::thread th_handle;
+#if RTDAG_MEM_ACCESS != ON
+    mem_traffic no_traffic;
+#endif
+
+    // Private copies of the live counters, published after each job (the
+    // DAG ones only by the sink)
+    live_task_stats live_stats = {};
+    live_dag_stats live_dag = {};
+
+#if RTDAG_TASK_IMPL == TASK_IMPL_PROCESS
+    pid_t pid = -1;
+#else
+    pthread_t th_handle;
+
+    // Passed to the task body by the thread
+    unsigned seed = 0;
+#endif
     void task_body(unsigned seed);
     void common_init();
     void loop_body_before(int iter);
     void loop_body_after(int iter, const struct timespec &duration);
     void common_exit();
+    void dump_records();
 
 protected:
     virtual void do_init() = 0;
@@ -97,29 +351,34 @@ protected:
 
 public:
     Task(Dag &dag, const std::string &name, const std::string &type,
-         const sched_info &scheduling, int cpu,
-         MultiQueue &in, std::vector<Edge *> out_edges) :
+         const sched_info &scheduling, int cpu, MultiQueue &in,
+         std::vector<Edge *> in_edges, std::vector<Edge *> out_edges,
+         JobRecords &records) :
         dag(dag),
         name(name),
         type(type),
         scheduling(scheduling),
         cpu(cpu),
         in_mq(in),
-        out_buffers(out_edges) {}
+        in_buffers(in_edges),
+        out_buffers(out_edges),
+        records(records),
+        exec_hist(*dag.arena.make<LatencyHistogram>()),
+        response_hist(*dag.arena.make<LatencyHistogram>(
+            nanoseconds(scheduling.deadline()).count())) {}
 
     virtual ~Task() = default;
 
-    // TODO: implement correctly the full process launcher
-    int start(int seed) {
-        th_handle = std::thread(&Task::task_body, this, seed);
+    // Returns 0 on success, -1 if the task could not be started
+    int start(int seed);
 
-	// TODO: Check errors and implement error code
-	return 0;
-    }
+    void wait(void);
 
-    void wait(void) {
-      th_handle.join();
+#if RTDAG_TASK_IMPL == TASK_IMPL_PROCESS
+    pid_t get_pid() const {
+        return pid;
     }
+#endif
 
     inline bool is_originator() const {
         return in_mq.size() == 0;
@@ -140,23 +399,67 @@ class GaussTask : public Task {
     const s32 matrix_size;
     const s32 omp_target;
 
+    // Relative tolerance of the execution time feedback (0 if disabled),
+    // and the estimate of ticks_per_us it adjusts after each job
+    const double feedback_tolerance;
+    double feedback_ticks_per_us;
+
+    // Fraction of the distance to the rate of the last job that the
+    // estimate moves, when out of tolerance
+    static constexpr double feedback_gain = 0.25;
+
+    // Runs the ticks of the estimate and corrects it with the CPU time the
+    // job actually took, which excludes preemptions
+    void feedback_loop_work(int iter) {
+        const double ticks = feedback_ticks_per_us * wcet.count();
+
+        const struct timespec before = thread_cputime();
+        Count_Fractional_Ticks(ticks);
+        const u64 ns = to_nanoseconds(thread_cputime() - before).count();
+
+        if (iter >= dag.startup.warmup_activations) {
+            cpu_times->record(ns);
+        }
+
+        const double requested_ns = nanoseconds(wcet).count();
+        if (ns == 0 || requested_ns == 0 ||
+            std::abs(ns / requested_ns - 1) <= feedback_tolerance) {
+            return;
+        }
+
+        const double rate = ticks / (ns / 1000.);
+        feedback_ticks_per_us += feedback_gain * (rate - feedback_ticks_per_us);
+    }
+
 public:
     GaussTask(Dag &dag, const std::string &name, const std::string &type,
               const sched_info &scheduling, int cpu,
-              MultiQueue &in_mq,
-              std::vector<Edge *> out_edges, microseconds wcet,
-              u64 expected_wcet_ratio, float ticks_per_us, s32 matrix_size,
-              s32 omp_target) :
-        Task(dag, name, type, scheduling, cpu, in_mq, out_edges),
+              MultiQueue &in_mq, std::vector<Edge *> in_edges,
+              std::vector<Edge *> out_edges, JobRecords &records,
+              microseconds wcet, u64 expected_wcet_ratio, float ticks_per_us,
+              s32 matrix_size, s32 omp_target, double feedback_tolerance) :
+        Task(dag, name, type, scheduling, cpu, in_mq, in_edges, out_edges,
+             records),
         wcet(wcet.count() * expected_wcet_ratio),
         ticks_per_us(ticks_per_us),
         matrix_size(matrix_size),
-        omp_target(omp_target) {}
+        omp_target(omp_target),
+        feedback_tolerance(feedback_tolerance),
+        feedback_ticks_per_us(ticks_per_us) {
+        if (feedback_tolerance > 0) {
+            const u64 requested_ns = nanoseconds(this->wcet).count();
+            cpu_times = dag.arena.make<cpu_time_stats>(
+                requested_ns, u64(requested_ns * feedback_tolerance));
+        }
+    }
 
     virtual rtgauss_type get_rtgauss_type() const = 0;
 
     void do_init() override {
-        rtgauss_init(matrix_size, get_rtgauss_type(), omp_target);
+        // The matrices are backed like the arena and prefaulted here, before
+        // the start barrier
+        rtgauss_init(matrix_size, get_rtgauss_type(), omp_target,
+                     dag.arena.get_backing());
 
         // Pre-load code on the CPU/GPU/... for fast execution later on!
         int retv = waste_calibrate(); // FIXME: implement it differently!!
@@ -167,7 +470,11 @@ public:
     void do_loop_work(int iter) override {
         LOG(INFO, "task %s (%u): running the processing step for %lu * %f\n",
             name.c_str(), iter, wcet.count(), ticks_per_us);
-        Count_Time_Ticks(wcet, ticks_per_us);
+        if (feedback_tolerance > 0) {
+            feedback_loop_work(iter);
+        } else {
+            Count_Time_Ticks(wcet, ticks_per_us);
+        }
     }
 
     void do_exit() override {
@@ -0,0 +1,111 @@
+#ifndef RTDAG_SLOT_POOL_H
+#define RTDAG_SLOT_POOL_H
+
+#include <atomic>
+#include <span>
+#include <stdexcept>
+
+#include "newstuff/cacheline.h"
+#include "newstuff/futex.h"
+#include "newstuff/futex_wait.h"
+#include "newstuff/integers.h"
+#include "newstuff/mtime.h"
+#include "newstuff/wait_policy.h"
+
+// Pool of fixed-size message slots owned by an edge, used in zero-copy mode.
+//
+// The producer loans a free slot, fills it in place and publishes its handle
+// (the slot index) to the consumer, which reads the message in place and
+// releases the slot once its job is done. Free slots circulate in a
+// single-producer single-consumer ring: only the edge producer calls
+// loan() and only the edge consumer calls release(). The producer waits for
+// a free slot with its own wait policy, like on a busy MultiQueue.
+//
+// Both the pool and its storage live in the DAG arena; the counters of the
+// producer and of the consumer are on different cache lines.
+class alignas(cache_line_size) SlotPool {
+    const u32 slot_size;
+
+    // nslots slots of slot_size bytes each
+    const std::span<u8> storage;
+
+    // The free handles, as many as available from ring[head] on (modulo
+    // nslots)
+    const std::span<u32> ring;
+
+    // How the producer waits for a free slot
+    wait_policy policy = wait_policy::BLOCK;
+    nanoseconds spin_limit{0};
+
+    // The next free handle to loan, private to the producer
+    u32 head = 0;
+
+    // Number of free slots, the producer waits on it
+    alignas(cache_line_size) futex_word available;
+
+    // Where the next released handle goes, private to the consumer
+    alignas(cache_line_size) u32 tail = 0;
+
+public:
+    SlotPool(std::span<u8> storage, std::span<u32> ring, u32 slot_size) :
+        slot_size(slot_size),
+        storage(storage),
+        ring(ring) {
+        if (ring.size() < 1 || storage.size() != ring.size() * slot_size) {
+            throw std::logic_error("Inconsistent slot pool size!");
+        }
+
+        for (u32 i = 0; i < ring.size(); ++i) {
+            ring[i] = i;
+        }
+
+        available.store(ring.size(), std::memory_order_relaxed);
+    }
+
+    // Set before the tasks start, like the policies of the MultiQueue
+    void set_policy(wait_policy policy, nanoseconds spin_limit) {
+        this->policy = policy;
+        this->spin_limit = spin_limit;
+    }
+
+    size_t size() const {
+        return ring.size();
+    }
+
+    std::span<u8> data() const {
+        return storage;
+    }
+
+    std::span<u8> get(u32 handle) {
+        return storage.subspan(handle * slot_size, slot_size);
+    }
+
+    // Returns the handle of a free slot, waiting for the consumer to
+    // release one if the pool is empty
+    u32 loan() {
+        futex_wait_until(available, policy, spin_limit, [](u32 state) {
+            return (state & FUTEX_COUNT_MASK) > 0;
+        });
+        available.fetch_sub(1, std::memory_order_acquire);
+
+        const u32 handle = ring[head];
+        head = (head + 1) % ring.size();
+        return handle;
+    }
+
+    // Gives the slot back to the producer
+    void release(u32 handle) {
+        ring[tail] = handle;
+        tail = (tail + 1) % ring.size();
+
+        // Publishes the handle and clears FUTEX_WAITER at the same time
+        u32 old = available.load(std::memory_order_relaxed);
+        while (!available.compare_exchange_weak(
+            old, (old & FUTEX_COUNT_MASK) + 1, std::memory_order_release,
+            std::memory_order_relaxed)) {
+        }
+        futex_notify(available, old);
+    }
+};
+
+#endif // RTDAG_SLOT_POOL_H
@@ -0,0 +1,75 @@
+#include "newstuff/startup.h"
+
+#include <alloca.h>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "logging.h"
+
+// Stack left untouched for the frames above prefault_stack()
+static constexpr size_t stack_in_use = 64 * 1024;
+
+bool lock_memory() {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_MEMLOCK, &rl) < 0) {
+        LOG(WARNING, "getrlimit(RLIMIT_MEMLOCK) failed: %s\n",
+            std::strerror(errno));
+        return false;
+    }
+
+    if (geteuid() != 0 && rl.rlim_cur != RLIM_INFINITY) {
+        LOG(WARNING,
+            "memory NOT locked, RLIMIT_MEMLOCK is %lu bytes (run as root "
+            "or raise it to unlimited)\n",
+            rl.rlim_cur);
+        return false;
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        LOG(WARNING, "mlockall() failed: %s\n", std::strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+bool set_stack_limit(size_t size) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_STACK, &rl) < 0) {
+        LOG(WARNING, "getrlimit(RLIMIT_STACK) failed: %s\n",
+            std::strerror(errno));
+        return false;
+    }
+
+    if (rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur >= size) {
+        return true;
+    }
+
+    rl.rlim_cur = size;
+    if (setrlimit(RLIMIT_STACK, &rl) < 0) {
+        LOG(WARNING, "could not set the stack size to %lu bytes: %s\n", size,
+            std::strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+__attribute__((noinline)) void prefault_stack(size_t size) {
+    if (size <= 2 * stack_in_use) {
+        size /= 2;
+    } else {
+        size -= stack_in_use;
+    }
+
+    u8 *stack = static_cast<u8 *>(alloca(size));
+    std::memset(stack, 0, size);
+
+    // The memory is never read, prevent the compiler from removing the
+    // writes
+    asm volatile("" : : "r"(stack) : "memory");
+}
@@ -0,0 +1,37 @@
+#ifndef RTDAG_STARTUP_H
+#define RTDAG_STARTUP_H
+
+#include <cstddef>
+
+#include "newstuff/integers.h"
+
+// What each task does in its startup phase, before the first barrier, so
+// that the first measured activations do not pay for page faults or cold
+// code paths
+struct startup_info {
+    // Lock all the current and future memory of the task (mlockall)
+    bool lock_memory = true;
+
+    // Stack size of each task in bytes, prefaulted during startup; 0 keeps
+    // the default size and does not prefault it
+    size_t stack_size = 0;
+
+    // Activations executed before the measured ones, not included in the
+    // response times
+    s64 warmup_activations = 0;
+};
+
+// Locks the current and future memory of the calling process. Fails with a
+// warning if the process is not allowed to lock an unlimited amount of
+// memory, since later allocations (e.g., thread stacks) would fail instead.
+bool lock_memory();
+
+// Allows the stack of the calling process to grow up to size bytes, needed
+// only when tasks are processes (thread stacks are allocated up front)
+bool set_stack_limit(size_t size);
+
+// Touches the stack of the calling thread, whose size is size bytes, leaving
+// some room for the frames that are already in use
+void prefault_stack(size_t size);
+
+#endif // RTDAG_STARTUP_H
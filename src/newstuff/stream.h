@@ -0,0 +1,136 @@
+#ifndef RTDAG_STREAM_H
+#define RTDAG_STREAM_H
+
+#include <atomic>
+#include <optional>
+
+#include "newstuff/histogram.h"
+#include "newstuff/integers.h"
+#include "newstuff/live.h"
+
+// A run with repetitions: 0 streams: it goes on until SIGINT or SIGTERM in
+// constant memory. Only the last activations are kept for the results, the
+// whole run is summarized by the histograms and, one interval at a time, by
+// the summaries the sink hands over to the main process while it runs.
+
+// Lets the main process stop a run before its last activation (in the
+// arena, read by all the tasks)
+struct run_control {
+    // Set on SIGINT or SIGTERM (by a signal handler), checked by the
+    // originator before releasing each instance
+    std::atomic<bool> stop_requested = false;
+
+    // Jobs of each task, warm-up included. When asked to stop the
+    // originator lowers it before releasing its last instance, hence the
+    // other tasks see the new value once they received that instance.
+    std::atomic<s64> njobs;
+
+    explicit run_control(s64 njobs) : njobs(njobs) {}
+};
+
+// Summary of the response times of the DAG over one interval, in ns
+struct interval_stats {
+    u64 index;
+
+    // On CLOCK_MONOTONIC, from the first to the last response time recorded
+    s64 start_ns;
+    s64 end_ns;
+
+    u64 activations;
+    u64 misses;
+    u64 min_ns;
+    u64 mean_ns;
+    u64 p50_ns;
+    u64 p99_ns;
+    u64 p999_ns;
+    u64 max_ns;
+};
+
+// The sink records the response times of the current interval in a
+// histogram (private to it) and posts the summary of each interval once it
+// is over in a small ring, that the main process drains. Each slot is a
+// sequence lock, the sink never waits for the main process: if the main
+// process falls behind by a whole ring the oldest summaries are lost.
+class StreamStats {
+    static constexpr u64 ring_size = 8;
+
+    const s64 interval_ns;
+
+    LatencyHistogram hist;
+    s64 start_ns = 0;
+    s64 last_ns = 0;
+    u64 index = 0;
+
+    Seqlock<interval_stats> ring[ring_size];
+    std::atomic<u64> posted = 0;
+    std::atomic<bool> done = false;
+
+    void post() {
+        const interval_stats stats = {
+            .index = index,
+            .start_ns = start_ns,
+            .end_ns = last_ns,
+            .activations = hist.size(),
+            .misses = hist.deadline_misses(),
+            .min_ns = hist.minimum(),
+            .mean_ns = u64(hist.mean()),
+            .p50_ns = hist.percentile(0.5),
+            .p99_ns = hist.percentile(0.99),
+            .p999_ns = hist.percentile(0.999),
+            .max_ns = hist.maximum(),
+        };
+
+        ring[index % ring_size].write(stats);
+        posted.store(++index, std::memory_order_release);
+        hist.reset();
+    }
+
+public:
+    StreamStats(s64 interval_ns, u64 threshold) :
+        interval_ns(interval_ns),
+        hist(threshold) {}
+
+    // Records a response time that ended at now_ns (sink only)
+    void record(u64 ns, s64 now_ns) {
+        if (hist.size() == 0) {
+            start_ns = now_ns;
+        }
+
+        hist.record(ns);
+        last_ns = now_ns;
+
+        if (now_ns - start_ns >= interval_ns) {
+            post();
+        }
+    }
+
+    // Posts the last interval, usually a shorter one (sink only, after its
+    // last job)
+    void finish() {
+        if (hist.size() > 0) {
+            post();
+        }
+        done.store(true, std::memory_order_release);
+    }
+
+    // Number of intervals posted so far
+    u64 size() const {
+        return posted.load(std::memory_order_acquire);
+    }
+
+    // Whether the sink posted its last interval
+    bool finished() const {
+        return done.load(std::memory_order_acquire);
+    }
+
+    // The summary of the given interval, if still in the ring
+    std::optional<interval_stats> get(u64 i) const {
+        const auto stats = ring[i % ring_size].read();
+        if (!stats || stats->index != i) {
+            return std::nullopt;
+        }
+        return stats;
+    }
+};
+
+#endif // RTDAG_STREAM_H
@@ -1,6 +1,15 @@
 #include "newstuff/taskset.h"
+#include "newstuff/blame.h"
+#include "newstuff/calibdb.h"
+#include "newstuff/timeline.h"
 #include <pthread.h>
 
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <thread>
+
 // static inline std::vector<int> output_tasks(const input_base &input,
 //                                             int task_id) {
 //     const int ntasks = input.get_n_tasks();
@@ -42,6 +51,260 @@ static inline s64 num_activations(std::chrono::microseconds hyperperiod,
     return hyperperiod / period * repetitions;
 }
 
+// Number of message slots of each edge in copy mode: one per instance in
+// flight, plus one that the producer can write while the consumer is still
+// copying the oldest message
+static inline int edge_slots(int max_inflight) {
+    return max_inflight + 1;
+}
+
+// Number of slots of each edge pool in zero-copy mode. By default there is
+// one slot per instance in flight, plus one held by the consumer during its
+// job and one filled by the producer, so that producers never wait for a
+// free slot.
+static inline int pool_slots(const input_base &input, int max_inflight) {
+    const int slots = input.get_edge_pool_slots();
+    return slots > 0 ? slots : max_inflight + 2;
+}
+
+// The placement of the edges memory, NONE when there is a single node
+static inline numa_placement placement(const input_base &input) {
+    const auto placement = numa_placement_from_string(input.get_numa_placement());
+    if (!placement) {
+        LOG(ERROR, "Unsupported NUMA placement %s\n",
+            input.get_numa_placement());
+        exit(EXIT_FAILURE);
+    }
+
+    return numa_nodes() > 1 ? *placement : numa_placement::NONE;
+}
+
+// The pages backing the arena and the task matrices
+static inline huge_pages backing(const input_base &input) {
+    const auto backing = huge_pages_from_string(input.get_huge_pages());
+    if (!backing) {
+        LOG(ERROR, "Unsupported huge pages backing %s\n",
+            input.get_huge_pages());
+        exit(EXIT_FAILURE);
+    }
+
+    return *backing;
+}
+
+static inline results_format results(const input_base &input) {
+    const auto format = results_format_from_string(input.get_results_format());
+    if (!format) {
+        LOG(ERROR, "Unsupported results format %s\n",
+            input.get_results_format());
+        exit(EXIT_FAILURE);
+    }
+
+    return *format;
+}
+
+static inline ftrace_mode ftrace(const input_base &input) {
+    const auto mode = ftrace_mode_from_string(input.get_ftrace());
+    if (!mode) {
+        LOG(ERROR, "Unsupported ftrace mode %s\n", input.get_ftrace());
+        exit(EXIT_FAILURE);
+    }
+
+    if (*mode == ftrace_mode::NONE && input.get_ftrace_snapshot()) {
+        LOG(WARNING, "ftrace_snapshot ignored, ftrace is disabled\n");
+    }
+
+    return *mode;
+}
+
+// Smallest stack that can be prefaulted safely
+static constexpr int min_stack_size_kb = 128;
+
+static inline startup_info startup(const input_base &input) {
+    const int stack_size_kb = input.get_stack_size_kb();
+    if (stack_size_kb != 0 && stack_size_kb < min_stack_size_kb) {
+        LOG(ERROR, "Invalid stack_size_kb %d, must be at least %d (or 0 for "
+                   "the default)\n",
+            stack_size_kb, min_stack_size_kb);
+        exit(EXIT_FAILURE);
+    }
+
+    if (input.get_warmup_activations() < 0) {
+        LOG(ERROR, "Invalid warmup_activations %d, must be positive\n",
+            input.get_warmup_activations());
+        exit(EXIT_FAILURE);
+    }
+
+    return startup_info{
+        .lock_memory = input.get_lock_memory(),
+        .stack_size = size_t(stack_size_kb) * 1024,
+        .warmup_activations = input.get_warmup_activations(),
+    };
+}
+
+// The ticks_per_us of a task: tasks_ticks_per_us if set, otherwise the
+// calibration of the CPU the task is pinned to (the loaded one if any, the
+// safer for WCETs), otherwise TICKS_PER_US
+static inline float task_ticks_per_us(const input_base &input, int task,
+                                      const CalibDb &db) {
+    if (const float v = input.get_ticks_per_us(task); v > 0) {
+        return v;
+    }
+
+    const int cpu = input.get_tasks_affinity(task);
+    if (cpu >= 0) {
+        calib_key key = calib_key_of(cpu, input.get_tasks_type(task),
+                                     input.get_matrix_size(task), "loaded");
+        if (const auto v = db.find(key)) {
+            return *v;
+        }
+
+        key.load = "isolated";
+        if (const auto v = db.find(key)) {
+            return *v;
+        }
+
+        if (!db.empty()) {
+            LOG(WARNING,
+                "No calibration for task %s in %s (CPU %d, %s governor at "
+                "%ld-%ld kHz, %s tasks, matrix size %d), using "
+                "TICKS_PER_US\n",
+                input.get_tasks_name(task), db.get_path().c_str(), cpu,
+                key.governor.c_str(), key.min_freq_khz, key.max_freq_khz,
+                key.type.c_str(), key.matrix_size);
+        }
+    }
+
+    if (ticks_per_us <= 0) {
+        LOG(ERROR,
+            "Task %s is not calibrated: pin it and run rtdag -c on its CPU, "
+            "or set tasks_ticks_per_us or TICKS_PER_US\n",
+            input.get_tasks_name(task));
+        exit(EXIT_FAILURE);
+    }
+
+    return ticks_per_us;
+}
+
+// Tolerance of the execution time feedback, as a fraction (0 if disabled)
+static inline double exec_feedback(const input_base &input) {
+    if (!input.get_exec_feedback()) {
+        return 0;
+    }
+
+    if (input.get_exec_feedback_tolerance() <= 0) {
+        LOG(ERROR, "Invalid exec_feedback_tolerance %g, must be positive\n",
+            input.get_exec_feedback_tolerance());
+        exit(EXIT_FAILURE);
+    }
+
+    return input.get_exec_feedback_tolerance() / 100;
+}
+
+// Number of the last activations kept in memory: all of them, or
+// stream_window when streaming (repetitions: 0)
+static inline s64 window(const input_base &input, s64 activations) {
+    if (activations > 0) {
+        return activations;
+    }
+
+    const int max_inflight = input.get_max_inflight_instances();
+    if (input.get_stream_window() <= max_inflight) {
+        LOG(ERROR, "Invalid stream_window %d, must be larger than "
+                   "max_inflight_instances (%d)\n",
+            input.get_stream_window(), max_inflight);
+        exit(EXIT_FAILURE);
+    }
+
+    if (input.get_stream_interval_s() < 1) {
+        LOG(ERROR, "Invalid stream_interval_s %d, must be positive\n",
+            input.get_stream_interval_s());
+        exit(EXIT_FAILURE);
+    }
+
+    return input.get_stream_window();
+}
+
+// Upper bound of the memory needed by the DAG arena, all the memory is
+// allocated up front. Each allocation may waste up to its alignment for
+// padding.
+static inline size_t arena_size(const input_base &input, s64 activations) {
+    const int ntasks = input.get_n_tasks();
+    const int depth =
+        std::clamp(input.get_max_inflight_instances(), 1, RTDAG_MAX_INFLIGHT);
+
+    size_t size = 0;
+    const auto reserve = [&size](size_t bytes, size_t align) {
+        size += bytes + align;
+    };
+
+    // Each NUMA region starts on a new page and ends on a page boundary,
+    // there is at most one region per queue and one per edge
+    const size_t page = SharedArena::page_size(backing(input));
+    const auto new_region = [&reserve, page,
+                             numa = placement(input) != numa_placement::NONE]() {
+        if (numa) {
+            reserve(page, page);
+        }
+    };
+
+    const s64 kept = window(input, activations);
+
+    reserve(sizeof(DagBarrier), alignof(DagBarrier));
+    reserve(sizeof(run_control), alignof(run_control));
+    reserve(depth * sizeof(struct timespec), cache_line_size);
+    reserve(kept * sizeof(microseconds), cache_line_size);
+    reserve(kept * sizeof(u8), cache_line_size);
+    reserve(sizeof(LatencyHistogram), alignof(LatencyHistogram));
+    if (activations == 0) {
+        reserve(sizeof(StreamStats), alignof(StreamStats));
+    }
+
+    // Unless streaming, the records of the warm-up jobs are kept too
+    const s64 jobs =
+        activations > 0
+            ? activations + std::max(input.get_warmup_activations(), 0)
+            : kept;
+
+    for (int to = 0; to < ntasks; ++to) {
+        new_region();
+        reserve(sizeof(MultiQueue), alignof(MultiQueue));
+        reserve(sizeof(JobRecords), alignof(JobRecords));
+        reserve(jobs * sizeof(job_record), cache_line_size);
+#if RTDAG_PERF_COUNTERS == ON
+        reserve(jobs * sizeof(perf_sample), cache_line_size);
+#endif
+        reserve(sizeof(LatencyHistogram), alignof(LatencyHistogram));
+        reserve(sizeof(LatencyHistogram), alignof(LatencyHistogram));
+        if (input.get_exec_feedback()) {
+            reserve(sizeof(cpu_time_stats), alignof(cpu_time_stats));
+        }
+
+        for (int from = 0; from < ntasks; ++from) {
+            const size_t msg_size = input.get_adjacency_matrix(from, to);
+            if (msg_size < 1) {
+                continue;
+            }
+
+            new_region();
+#if RTDAG_ZERO_COPY == ON
+            const size_t slots = pool_slots(input, depth);
+            reserve(sizeof(SlotPool), alignof(SlotPool));
+            reserve(slots * msg_size, cache_line_size);
+            reserve(slots * sizeof(u32), cache_line_size);
+            reserve(edge_slots(depth) * sizeof(u32), cache_line_size);
+#else
+            reserve(msg_size * edge_slots(depth), cache_line_size);
+            reserve(msg_size, cache_line_size);
+            reserve(msg_size, cache_line_size);
+#endif
+            reserve(jobs * sizeof(s64), cache_line_size);
+        }
+    }
+
+    // Round up to whole pages
+    return (size + page - 1) / page * page;
+}
+
 static inline int
 task_single_check(const std::vector<std::unique_ptr<Task>> &tasks,
                   const auto predicate, const std::string &which) {
@@ -71,27 +334,77 @@ task_single_check(const std::vector<std::unique_ptr<Task>> &tasks,
     return task_iter - begin;
 }
 
+static inline s64 num_activations(const input_base &input) {
+    return num_activations(std::chrono::microseconds(input.get_hyperperiod()),
+                           std::chrono::microseconds(input.get_period()),
+                           input.get_repetitions());
+}
+
 DagTaskset::DagTaskset(const input_base &input) :
-    dag(input.get_dagset_name(), std::chrono::microseconds(input.get_period()),
+    arena(input.get_dagset_name(), arena_size(input, num_activations(input)),
+          backing(input)),
+    dag(arena, input.get_dagset_name(),
+        std::chrono::microseconds(input.get_period()),
         std::chrono::microseconds(input.get_deadline()),
-        num_activations(std::chrono::microseconds(input.get_hyperperiod()),
-                        std::chrono::microseconds(input.get_period()),
-                        input.get_repetitions()),
-        input.get_n_tasks()) {
+        num_activations(input), window(input, num_activations(input)),
+        input.get_n_tasks(),
+        input.get_max_inflight_instances(), placement(input),
+        startup(input), results(input)),
+    timeline(input.get_timeline()) {
     int ntasks = input.get_n_tasks();
 
-    // Create the in_queues for each task
-    for (int task_id = 0; task_id < ntasks; ++task_id) {
-        int inputs_count = howmany_inputs(input, task_id);
+    if (dag.max_inflight < 1 || dag.max_inflight > RTDAG_MAX_INFLIGHT) {
+        LOG(ERROR,
+            "Invalid max_inflight_instances %d, must be between 1 and %d "
+            "(enable RTDAG_PIPELINING and increase RTDAG_BUFFER_LINES to "
+            "allow more)\n",
+            dag.max_inflight, RTDAG_MAX_INFLIGHT);
+        exit(EXIT_FAILURE);
+    }
+
+#if RTDAG_ZERO_COPY == ON
+    if (input.get_edge_pool_slots() < 0) {
+        LOG(ERROR, "Invalid edge_pool_slots %d, must be positive (or 0 for "
+                   "the default)\n",
+            input.get_edge_pool_slots());
+        exit(EXIT_FAILURE);
+    }
+#endif
+
+    // The node each edge is bound to, -1 to leave it wherever it is touched
+    // first
+    const auto node_of_task = [&](int task) {
+        return dag.placement == numa_placement::NONE
+                   ? -1
+                   : numa_node_of_cpu(input.get_tasks_affinity(task));
+    };
+
+    // The job records of each task
+    std::vector<JobRecords *> job_rings;
+
+    // Create the in_queue of each task (and its job records), immediately
+    // followed by the buffers of its input edges, so that the data of each
+    // consumer is contiguous in the arena
+    for (int receiver = 0; receiver < ntasks; ++receiver) {
+        int inputs_count = howmany_inputs(input, receiver);
         //if (inputs_count < 1) {
         //    inputs_count =
         //        1; // Will be used between the originator and the sink
         //}
-        dag.in_queues.emplace_back(std::make_unique<MultiQueue>(inputs_count));
-    }
 
-    // All the in_queues are in place, now we can create the edges
-    for (int receiver = 0; receiver < ntasks; ++receiver) {
+        // The queue is always written by both sides, keep it with the
+        // consumer that polls it
+        arena.set_node(node_of_task(receiver));
+        dag.in_queues.emplace_back(
+            arena.make<MultiQueue>(inputs_count, dag.max_inflight));
+        job_rings.emplace_back(arena.make<JobRecords>(
+            arena.make_array<job_record>(dag.kept_jobs(), cache_line_size)
+#if RTDAG_PERF_COUNTERS == ON
+                ,
+            arena.make_array<perf_sample>(dag.kept_jobs(), cache_line_size)
+#endif
+                ));
+
         int push_idx = 0;
         for (int sender = 0; sender < ntasks; ++sender) {
             int msg_size = input.get_adjacency_matrix(sender, receiver);
@@ -100,13 +413,92 @@ DagTaskset::DagTaskset(const input_base &input) :
             }
 
             // There is an edge from sender to receiver of msg_size bytes
-            dag.edges.emplace_back(*dag.in_queues[receiver], sender, receiver,
-                                   push_idx, msg_size);
+            arena.set_node(dag.placement == numa_placement::PRODUCER
+                               ? node_of_task(sender)
+                               : node_of_task(receiver));
+
+#if RTDAG_ZERO_COPY == ON
+            const int slots = pool_slots(input, dag.max_inflight);
+            SlotPool *pool = arena.make<SlotPool>(
+                arena.make_array<u8>(msg_size * slots, cache_line_size),
+                arena.make_array<u32>(slots, cache_line_size), msg_size);
+
+            dag.edges.emplace_back(
+                *dag.in_queues[receiver], sender, receiver, push_idx, *pool,
+                arena.make_array<u32>(edge_slots(dag.max_inflight),
+                                      cache_line_size),
+                arena.make_array<s64>(dag.kept_jobs(), cache_line_size),
+                msg_size);
+#else
+            dag.edges.emplace_back(
+                *dag.in_queues[receiver], sender, receiver, push_idx,
+                arena.make_array<u8>(msg_size * edge_slots(dag.max_inflight),
+                                     cache_line_size),
+                arena.make_array<u8>(msg_size, cache_line_size),
+                arena.make_array<u8>(msg_size, cache_line_size),
+                arena.make_array<s64>(dag.kept_jobs(), cache_line_size),
+                msg_size);
+#endif
 
             push_idx++;
         }
     }
 
+    arena.set_node(-1);
+
+    if (dag.streaming()) {
+        dag.stream = arena.make<StreamStats>(
+            nanoseconds(seconds(input.get_stream_interval_s())).count(),
+            nanoseconds(dag.e2e_deadline).count());
+    }
+
+    // No task must take a page fault on the shared data once started
+    arena.prefault();
+
+    LOG(INFO, "DAG arena: %lu bytes used out of %lu\n", arena.size_used(),
+        arena.size());
+
+    // Each task waits on its input queue as a consumer and on its output
+    // edges as a producer according to its own wait policy
+    std::vector<wait_policy> policies;
+    for (int i = 0; i < ntasks; ++i) {
+        const std::string policy_name = input.get_tasks_wait_policy(i);
+        const auto policy = wait_policy_from_string(policy_name);
+        if (!policy) {
+            LOG(ERROR, "Unsupported wait policy %s\n", policy_name.c_str());
+            exit(EXIT_FAILURE);
+        }
+
+#if RTDAG_MQUEUE_IMPL == MQUEUE_IMPL_MUTEX
+        if (*policy != wait_policy::BLOCK) {
+            LOG(ERROR,
+                "Wait policy %s requires RTDAG_MQUEUE_IMPL=futex, only "
+                "block is supported!\n",
+                policy_name.c_str());
+            exit(EXIT_FAILURE);
+        }
+#endif
+
+        policies.push_back(*policy);
+    }
+
+    const auto spin_limit =
+        std::chrono::microseconds(input.get_wait_spin_us());
+    for (int i = 0; i < ntasks; ++i) {
+        dag.in_queues[i]->set_consumer_policy(policies[i]);
+        dag.in_queues[i]->set_spin_limit(spin_limit);
+    }
+
+    for (Edge &edge : dag.edges) {
+        edge.mq.set_producer_policy(edge.push_idx, policies[edge.from]);
+#if RTDAG_ZERO_COPY == ON
+        edge.pool->set_policy(policies[edge.from], spin_limit);
+#endif
+    }
+
+    // Calibrations saved by rtdag -c, looked up for each pinned task
+    const CalibDb calib;
+
     // Finally, now that we have all the data, we can create the tasks (not
     // the actual threads, only the tasks representation and data)
     for (int i = 0; i < ntasks; ++i) {
@@ -133,20 +525,22 @@ DagTaskset::DagTaskset(const input_base &input) :
 
         if (task_type == "cpu") {
             tasks.emplace_back(std::make_unique<CPUTask>(
-                dag, name, task_type, sched_info, cpu, *dag.in_queues[i], out_edges,
+                dag, name, task_type, sched_info, cpu, *dag.in_queues[i],
+                in_edges, out_edges, *job_rings[i],
                 std::chrono::microseconds(input.get_tasks_wcet(i)),
                 input.get_tasks_expected_wcet_ratio(i),
-                input.get_ticks_per_us(i), input.get_matrix_size(i),
-                input.get_omp_target(i)));
+                task_ticks_per_us(input, i, calib), input.get_matrix_size(i),
+                input.get_omp_target(i), exec_feedback(input)));
         }
 #if RTDAG_OMP_SUPPORT == ON
         else if (task_type == "omp") {
             tasks.emplace_back(std::make_unique<OMPTask>(
-                dag, name, task_type, sched_info, cpu, in_edges, out_edges,
+                dag, name, task_type, sched_info, cpu, *dag.in_queues[i],
+                in_edges, out_edges, *job_rings[i],
                 std::chrono::microseconds(input.get_tasks_wcet(i)),
                 input.get_tasks_expected_wcet_ratio(i),
-                input.get_ticks_per_us(i), input.get_matrix_size(i),
-                input.get_omp_target(i)));
+                task_ticks_per_us(input, i, calib), input.get_matrix_size(i),
+                input.get_omp_target(i), exec_feedback(input)));
         }
 #endif
         // TODO: FRED
@@ -159,17 +553,49 @@ DagTaskset::DagTaskset(const input_base &input) :
         return task.is_originator();
     };
 
-    const auto is_sink = [](const Task &task) { return task.is_originator(); };
+    const auto is_sink = [](const Task &task) { return task.is_sink(); };
 
     int orig_index = task_single_check(tasks, is_originator, "originator");
-    task_single_check(tasks, is_sink, "sink");
+    int sink_index = task_single_check(tasks, is_sink, "sink");
 
-    dag.start_dag = dag.in_queues[orig_index].get();
+    dag.start_dag = dag.in_queues[orig_index];
+
+    // The sink is the only producer on the originator queue
+    dag.start_dag->set_producer_policy(0, policies[sink_index]);
+
+    if (input.get_live_metrics()) {
+        live.emplace(dag.name, ntasks);
+
+        live_header &header = live->header();
+        header.period_ns = nanoseconds(dag.period).count();
+        header.deadline_ns = nanoseconds(dag.e2e_deadline).count();
+        header.num_activations = dag.num_activations;
+        trace_set_name(header.dag_name, dag.name);
+        dag.live = &header.dag;
+
+        for (int i = 0; i < ntasks; ++i) {
+            live_task &task = live->task(i);
+            trace_set_name(task.name, tasks[i]->name);
+            task.cpu = tasks[i]->cpu;
+            tasks[i]->live = &task;
+        }
+
+        live->publish();
+    }
+
+    // Opened here, the tasks (even as processes) use the same files
+    if (const ftrace_mode mode = ftrace(input); mode != ftrace_mode::NONE) {
+        ftrace_files.emplace(input.get_tracefs_path(), mode,
+                             input.get_ftrace_snapshot());
+        dag.ftrace = &*ftrace_files;
+    }
 
     // The originator will wait for someone to wake him up before executing
     // on this queue, hence we push something on it to allow it to start
-    // executing the first time
-    dag.start_dag->push(0);
+    // executing the first time (once per instance that can be in flight)
+    for (int i = 0; i < dag.max_inflight; ++i) {
+        dag.start_dag->push(0);
+    }
 }
 
 void DagTaskset::print(std::ostream &os) {
@@ -179,10 +605,182 @@ void DagTaskset::print(std::ostream &os) {
     os.flush();
 }
 
+void DagTaskset::save_results() {
+    if (dag.results != results_format::BINARY) {
+        return;
+    }
+
+    const s64 first = dag.startup.warmup_activations;
+
+    trace_header header = {};
+    std::memcpy(header.magic, trace_magic, sizeof(trace_magic));
+    header.version = trace_version;
+    header.header_size = sizeof(trace_header);
+    header.task_size = sizeof(trace_task);
+    header.record_size = sizeof(job_record);
+    header.sample_size =
+        tasks[0]->records.has_samples() ? sizeof(perf_sample) : 0;
+    header.ntasks = tasks.size();
+    header.max_inflight = dag.max_inflight;
+    header.period_ns = nanoseconds(dag.period).count();
+    header.deadline_ns = nanoseconds(dag.e2e_deadline).count();
+    header.num_activations = dag.num_measured() - dag.first_kept();
+    header.warmup_activations = first;
+    header.first_activation = dag.first_kept();
+    trace_set_name(header.dag_name, dag.name);
+
+    size_t size = sizeof(header) + tasks.size() * sizeof(trace_task) +
+                  header.num_activations * sizeof(s64);
+    for (const auto &task_ptr : tasks) {
+        size += task_ptr->records.size(first) *
+                (sizeof(job_record) + header.sample_size);
+    }
+
+    TraceWriter trace(dag.name + "/" + dag.name + ".trace", size);
+    trace.write(header);
+
+    for (const auto &task_ptr : tasks) {
+        trace_task task = {};
+        trace_set_name(task.name, task_ptr->name);
+        task.cpu = task_ptr->cpu;
+        task.njobs = task_ptr->records.size(first);
+        if (task_ptr->records.hardware_samples) {
+            task.flags |= trace_task_hw_counters;
+        }
+        trace.write(task);
+    }
+
+    for (s64 m = dag.first_kept(); m < dag.num_measured(); ++m) {
+        trace.write(s64(dag.response_time(m).count()));
+    }
+
+    for (const auto &task_ptr : tasks) {
+        task_ptr->records.for_each(
+            first, [&trace](const job_record &r) { trace.write(r); });
+        task_ptr->records.for_each_sample(
+            first, [&trace](const perf_sample &c) { trace.write(c); });
+    }
+}
+
+void DagTaskset::save_timeline() {
+    if (!timeline) {
+        return;
+    }
+
+    const std::string fname = dag.name + "/" + dag.name + ".timeline.json";
+    std::ofstream os(fname);
+    if (!os) {
+        LOG(ERROR, "could not create %s\n", fname.c_str());
+        return;
+    }
+
+    write_timeline(os, dag, tasks);
+}
+
+void DagTaskset::save_blame_report(std::ostream &os) {
+    const BlameReport report(dag, tasks);
+    if (report.size() == 0) {
+        return;
+    }
+
+    const std::string fname = dag.name + "/" + dag.name + ".blame.log";
+    std::ofstream file(fname);
+    if (!file) {
+        LOG(ERROR, "could not create %s\n", fname.c_str());
+        return;
+    }
+    report.write(file);
+
+    const int task = report.worst_task();
+    const auto [from, to] = report.worst_edge();
+    os << report.size() << " deadline misses";
+    if (task >= 0) {
+        os << ", blamed most often on task " << tasks[task]->name;
+    }
+    if (from >= 0) {
+        os << " and edge n" << from << "_n" << to;
+    }
+    os << ", see " << fname << std::endl;
+}
+
+static double us(u64 ns) {
+    return ns / 1000.;
+}
+
+void DagTaskset::save_intervals() {
+    using namespace std::chrono_literals;
+
+    const std::string fname = dag.name + "/" + dag.name + ".intervals.log";
+    std::ofstream os(fname);
+    if (!os) {
+        // The summaries are still drained, the sink does not care
+        LOG(ERROR, "could not create %s\n", fname.c_str());
+    }
+
+    // One line per interval, flushed as soon as the sink posts it: index,
+    // start and end in ns, activations, misses, then min, mean, p50, p99,
+    // p99.9 and max of the response times in us
+    char line[256];
+    u64 next = 0;
+    for (bool done = false; !done;) {
+        std::this_thread::sleep_for(100ms);
+
+        // Whatever was posted before the sink finished is there
+        done = dag.stream->finished();
+        for (const u64 posted = dag.stream->size(); next < posted; ++next) {
+            const auto s = dag.stream->get(next);
+            if (!s) {
+                LOG(WARNING, "summary of interval %lu lost\n", next);
+                continue;
+            }
+
+            std::snprintf(line, sizeof(line),
+                          "%lu %ld %ld %lu %lu %.3f %.3f %.3f %.3f %.3f %.3f\n",
+                          s->index, s->start_ns, s->end_ns, s->activations,
+                          s->misses, us(s->min_ns), us(s->mean_ns),
+                          us(s->p50_ns), us(s->p99_ns), us(s->p999_ns),
+                          us(s->max_ns));
+            os << line;
+        }
+        os.flush();
+    }
+}
+
+void DagTaskset::print_summary(std::ostream &os) {
+    os << "DAG " << dag.name << " response times: ";
+    dag.response_hist.summary(os);
+
+    for (const auto &task_ptr : tasks) {
+        os << " " << task_ptr->name << " execution times: ";
+        task_ptr->exec_hist.summary(os);
+        os << " " << task_ptr->name << " response times: ";
+        task_ptr->response_hist.summary(os);
+        if (const cpu_time_stats *c = task_ptr->cpu_times) {
+            os << " " << task_ptr->name << " CPU times (requested "
+               << c->requested_ns / 1000 << " +- " << c->tolerance_ns / 1000.
+               << " us): short " << c->short_jobs << ", long "
+               << c->long_jobs << ", ";
+            c->hist.summary(os);
+        }
+    }
+    os.flush();
+}
+
 void DagTaskset::launch(std::vector<int> &pids, unsigned seed) {
     for (auto &task_ptr : tasks) {
-        task_ptr->start(seed);
+        if (task_ptr->start(seed) < 0) {
+#if RTDAG_TASK_IMPL == TASK_IMPL_PROCESS
+            // The tasks already started would wait forever on the barrier
+            for (int pid : pids) {
+                kill(pid, SIGKILL);
+            }
+#endif
+            exit(EXIT_FAILURE);
+        }
 
+#if RTDAG_TASK_IMPL == TASK_IMPL_PROCESS
+        pids.push_back(task_ptr->get_pid());
+#else
         // TODO: save the tid once the thread starts in a
         // shared box and retrieve it from here!
 
@@ -193,6 +791,12 @@ void DagTaskset::launch(std::vector<int> &pids, unsigned seed) {
         // pthread_getunique_np(&self, &tid);
 
         // pids.push_back(tid);
+#endif
+    }
+
+    // The main process has nothing else to do while the DAG runs
+    if (dag.stream) {
+        save_intervals();
     }
 
     for (auto &task_ptr : tasks) {
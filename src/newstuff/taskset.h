@@ -5,17 +5,50 @@
 #include "rtask.h"
 
 #include <barrier>
+#include <optional>
 
 struct DagTaskset {
+    // Must be constructed before (and destroyed after) the dag
+    SharedArena arena;
     Dag dag;
     std::vector<std::unique_ptr<Task>> tasks;
 
+    // Counters published for rtdag-top, if enabled
+    std::optional<LiveMetrics> live;
+
+    // The tracefs files the tasks write their markers to, if enabled
+    std::optional<Ftrace> ftrace_files;
+
+    // Whether to save the timeline of the jobs at the end
+    const bool timeline;
+
 public:
     DagTaskset(const input_base &input);
 
     void print(std::ostream &os);
 
+    // Saves the results in the binary format, if selected (the text files
+    // are written by the tasks themselves)
+    void save_results();
+
+    // Saves the timeline in <dag_name>/<dag_name>.timeline.json, if enabled
+    void save_timeline();
+
+    // Saves the critical paths of the instances that missed the deadline in
+    // <dag_name>/<dag_name>.blame.log, if any, and summarizes it on os
+    void save_blame_report(std::ostream &os);
+
+    // Latency summary of the DAG and of each task, once they are done
+    void print_summary(std::ostream &os);
+
+    // Starts the tasks and waits for them to be done
     void launch(std::vector<int> &pids, unsigned seed);
+
+private:
+    // Saves the summaries of the intervals of a streaming run in
+    // <dag_name>/<dag_name>.intervals.log as the sink posts them, until it
+    // is done
+    void save_intervals();
 };
 
 #endif // RTDAG_TASKSET_H
@@ -0,0 +1,206 @@
+#include "newstuff/timeline.h"
+
+#include <cstdio>
+#include <string>
+
+static std::string to_us(s64 ns) {
+    char us[32];
+    std::snprintf(us, sizeof(us), "%.3f", ns / 1000.);
+    return us;
+}
+
+// The given text as a JSON string, quotes included: the DAG and task names
+// come from the input file and may contain any character
+static std::string quoted(const std::string &text) {
+    std::string out = "\"";
+    for (const char c : text) {
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x",
+                              unsigned(c));
+                out += escaped;
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out + "\"";
+}
+
+// Writes the events one per line, separated by commas, with timestamps in
+// us (the unit of the format) relative to the first release
+class EventWriter {
+    std::ostream &os;
+    const s64 t0;
+    bool first = true;
+
+public:
+    EventWriter(std::ostream &os, s64 t0) : os(os), t0(t0) {}
+
+    // Starts an event with the given phase and name, on the track of the
+    // given task (-1 for the process only)
+    EventWriter &begin(const char *ph, const std::string &name, int tid) {
+        os << (first ? "\n" : ",\n") << "{\"ph\":\"" << ph
+           << "\",\"name\":" << quoted(name) << ",\"pid\":1";
+        if (tid >= 0) {
+            os << ",\"tid\":" << tid;
+        }
+        first = false;
+        return *this;
+    }
+
+    template <class T>
+    EventWriter &field(const char *key, const T &value) {
+        os << ",\"" << key << "\":" << value;
+        return *this;
+    }
+
+    EventWriter &string(const char *key, const std::string &value) {
+        os << ",\"" << key << "\":" << quoted(value);
+        return *this;
+    }
+
+    EventWriter &time(const char *key, s64 ns) {
+        return field(key, to_us(ns - t0));
+    }
+
+    EventWriter &duration(s64 from_ns, s64 to_ns) {
+        return time("ts", from_ns).field("dur", to_us(to_ns - from_ns));
+    }
+
+    // Raw JSON object with the arguments of the event
+    EventWriter &args(const std::string &json) {
+        return field("args", "{" + json + "}");
+    }
+
+    void end() {
+        os << "}";
+    }
+};
+
+void write_timeline(std::ostream &os, const Dag &dag,
+                    const std::vector<std::unique_ptr<Task>> &tasks) {
+    const s64 first = dag.startup.warmup_activations;
+
+    std::vector<TaskJobs> jobs;
+    s64 t0 = 0;
+    for (const auto &task_ptr : tasks) {
+        jobs.emplace_back(task_ptr->records, first);
+
+        const auto &all = jobs.back().all();
+        if (!all.empty() && (t0 == 0 || all.front().release < t0)) {
+            t0 = all.front().release;
+        }
+    }
+
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    EventWriter ev(os, t0);
+
+    ev.begin("M", "process_name", -1)
+        .args("\"name\":" + quoted(dag.name))
+        .end();
+
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        ev.begin("M", "thread_name", t)
+            .args("\"name\":" + quoted(tasks[t]->name))
+            .end();
+        ev.begin("M", "thread_sort_index", t)
+            .args("\"sort_index\":" + std::to_string(t))
+            .end();
+
+        for (const auto &r : jobs[t].all()) {
+            ev.begin("X", "job", t)
+                .string("cat", "job")
+                .duration(r.wakeup, r.pushed)
+                .args("\"iter\":" + std::to_string(r.iter) +
+                      ",\"cpu\":" + std::to_string(r.cpu))
+                .end();
+            ev.begin("X", "work", t)
+                .string("cat", "job")
+                .duration(r.start, r.end)
+                .end();
+        }
+    }
+
+    // Flow ids must be unique, one per edge per instance
+    s64 flow_id = 0;
+    for (const auto &edge : dag.edges) {
+        std::string name = "n";
+        name += std::to_string(edge.from) + "_n" + std::to_string(edge.to);
+
+        for (const auto &producer : jobs[edge.from].all()) {
+            const job_record *consumer = jobs[edge.to].find(producer.iter);
+            if (!consumer) {
+                continue;
+            }
+
+            ev.begin("s", name, edge.from)
+                .string("cat", "edge")
+                .field("id", flow_id)
+                .time("ts", producer.end)
+                .end();
+            ev.begin("f", name, edge.to)
+                .string("cat", "edge")
+                .string("bp", "e")
+                .field("id", flow_id)
+                .time("ts", consumer->wakeup)
+                .end();
+            ++flow_id;
+        }
+    }
+
+    // The instances end with the sink
+    int sink = -1;
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        if (tasks[t]->is_sink()) {
+            sink = t;
+        }
+    }
+
+    for (s64 m = dag.first_kept(); sink >= 0 && m < dag.num_measured(); ++m) {
+        const s64 iter = first + m;
+        const microseconds response = dag.response_time(m);
+        const job_record *r = jobs[sink].find(iter);
+        if (!r) {
+            continue;
+        }
+
+        ev.begin("b", "instance", sink)
+            .string("cat", "dag")
+            .field("id", iter)
+            .time("ts", r->release)
+            .end();
+        ev.begin("e", "instance", sink)
+            .string("cat", "dag")
+            .field("id", iter)
+            .time("ts", r->pushed)
+            .args("\"response_us\":" + std::to_string(response.count()))
+            .end();
+
+        if (dag.missed(m)) {
+            ev.begin("i", "deadline miss", sink)
+                .string("cat", "dag")
+                .string("s", "g")
+                .time("ts", r->pushed)
+                .args("\"iter\":" + std::to_string(iter) +
+                      ",\"response_us\":" + std::to_string(response.count()))
+                .end();
+        }
+    }
+
+    os << "\n]}\n";
+}
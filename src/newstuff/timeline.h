@@ -0,0 +1,23 @@
+#ifndef RTDAG_TIMELINE_H
+#define RTDAG_TIMELINE_H
+
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "newstuff/rtask.h"
+
+// Writes the timeline of the measured jobs in the Chrome Trace Event JSON
+// format, which can be opened with Perfetto (ui.perfetto.dev) or
+// chrome://tracing. It is built after the run from the job records only:
+//
+//  - each task is a track, each job a slice from its wake-up to the end of
+//    its pushes, with its work as a nested slice;
+//  - each edge of each DAG instance is a flow arrow from the end of the work
+//    of the producer to the wake-up of the consumer;
+//  - each DAG instance is an async slice from its release to the end of the
+//    sink, each deadline miss an instant event at the end of the sink.
+void write_timeline(std::ostream &os, const Dag &dag,
+                    const std::vector<std::unique_ptr<Task>> &tasks);
+
+#endif // RTDAG_TIMELINE_H
@@ -0,0 +1,50 @@
+#include "newstuff/trace.h"
+
+#include <cerrno>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "logging.h"
+
+std::optional<results_format> results_format_from_string(const std::string &s) {
+    if (s == "text") {
+        return results_format::TEXT;
+    }
+    if (s == "binary") {
+        return results_format::BINARY;
+    }
+    return std::nullopt;
+}
+
+TraceWriter::TraceWriter(const std::string &fname, size_t size) : size(size) {
+    fd = open(fname.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        LOG(ERROR, "could not create %s: %s\n", fname.c_str(),
+            std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (ftruncate(fd, size) < 0) {
+        LOG(ERROR, "could not resize %s: %s\n", fname.c_str(),
+            std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        LOG(ERROR, "could not map %s: %s\n", fname.c_str(),
+            std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+
+    base = static_cast<u8 *>(addr);
+}
+
+TraceWriter::~TraceWriter() {
+    // The kernel writes the pages back, no need to wait for it
+    munmap(base, size);
+    close(fd);
+}
@@ -0,0 +1,124 @@
+#ifndef RTDAG_TRACE_H
+#define RTDAG_TRACE_H
+
+#include <cstring>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#include "newstuff/integers.h"
+#include "newstuff/job_record.h"
+
+// How the results of a run are saved
+enum class results_format {
+    TEXT,   // one text file per task, plus one for the response times
+    BINARY, // a single binary trace, read with rtdag-trace
+};
+
+std::optional<results_format> results_format_from_string(const std::string &s);
+
+// Binary trace of a run, saved in <dag_name>/<dag_name>.trace. The layout is
+// (all integers in native byte order, no padding anywhere):
+//
+//  trace_header
+//  trace_task[ntasks]
+//  s64 response_times[num_activations], in us, from first_activation on
+//  job_record[njobs] of the first task
+//  perf_sample[njobs] of the first task, if sample_size > 0
+//  job_record[njobs] of the second task
+//  perf_sample[njobs] of the second task, if sample_size > 0
+//  ...
+//
+// Readers must check the version and use the sizes in the header to skip
+// fields added by later versions at the end of each structure.
+//
+// Version 2 added the performance counters (sample_size and the flags of
+// each task). Version 3 added first_activation, since streaming runs keep
+// only the last activations.
+
+constexpr char trace_magic[8] = {'R', 'T', 'D', 'A', 'G', 'T', 'R', 'C'};
+constexpr u32 trace_version = 3;
+
+struct trace_header {
+    char magic[8];
+    u32 version;
+
+    // Sizes of the structures in the file
+    u32 header_size;
+    u32 task_size;
+    u32 record_size;
+
+    u32 ntasks;
+    u32 max_inflight;
+    s64 period_ns;
+    s64 deadline_ns;
+    s64 num_activations;
+    s64 warmup_activations;
+    char dag_name[64];
+
+    // Size of each perf_sample, 0 if the counters were not recorded
+    u32 sample_size;
+    u32 unused;
+
+    // The measured activation of the first response time saved (0 unless
+    // streaming)
+    s64 first_activation;
+};
+
+// The samples of the task include the hardware counters (otherwise only
+// the software ones are valid)
+constexpr u32 trace_task_hw_counters = 1 << 0;
+
+struct trace_task {
+    char name[48];
+    s32 cpu;
+    u32 flags;
+    s64 njobs;
+};
+
+static_assert(sizeof(trace_header) == 144);
+static_assert(sizeof(trace_task) == 64);
+static_assert(sizeof(job_record) == 56);
+static_assert(sizeof(perf_sample) == 56);
+
+// Copies a string into a fixed-size, NUL-terminated field
+template <size_t N>
+static inline void trace_set_name(char (&field)[N], const std::string &s) {
+    std::memset(field, 0, N);
+    std::strncpy(field, s.c_str(), N - 1);
+}
+
+// A trace file of known size, mapped in memory and filled in sequentially
+class TraceWriter {
+    int fd = -1;
+    u8 *base = nullptr;
+    size_t size = 0;
+    size_t offset = 0;
+
+public:
+    // Exits on failure
+    TraceWriter(const std::string &fname, size_t size);
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    template <class T>
+    void write(const T &value) {
+        write(std::span<const T>(&value, 1));
+    }
+
+    template <class T>
+    void write(std::span<const T> values) {
+        const size_t bytes = values.size_bytes();
+        if (offset + bytes > size) {
+            throw std::logic_error("Exceeded the size of the trace!");
+        }
+
+        std::memcpy(base + offset, values.data(), bytes);
+        offset += bytes;
+    }
+};
+
+#endif // RTDAG_TRACE_H
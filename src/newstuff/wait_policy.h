@@ -0,0 +1,47 @@
+#ifndef RTDAG_WAIT_POLICY_H
+#define RTDAG_WAIT_POLICY_H
+
+#include <optional>
+#include <string>
+
+// How a task waits on a MultiQueue, both as a consumer (waiting for all its
+// input edges) and as a producer (waiting for a busy output edge to free
+// up).
+enum class wait_policy {
+    // Sleep in the kernel until woken up (default)
+    BLOCK,
+    // Busy-wait, never releasing the CPU
+    SPIN,
+    // Busy-wait for a bounded amount of time, then sleep in the kernel
+    SPIN_BLOCK,
+    // Call sched_yield() until the condition holds
+    YIELD,
+};
+
+static inline std::optional<wait_policy>
+wait_policy_from_string(const std::string &str) {
+    if (str == "block") {
+        return wait_policy::BLOCK;
+    }
+    if (str == "spin") {
+        return wait_policy::SPIN;
+    }
+    if (str == "spin_block") {
+        return wait_policy::SPIN_BLOCK;
+    }
+    if (str == "yield") {
+        return wait_policy::YIELD;
+    }
+    return std::nullopt;
+}
+
+// Hint to the CPU that we are busy-waiting
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+#endif // RTDAG_WAIT_POLICY_H
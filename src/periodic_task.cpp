@@ -1,5 +1,6 @@
 
 #include "periodic_task.h"
+#include <errno.h>
 
 static void inc_period(struct period_info *pinfo, long delta_ns) 
 {
@@ -23,8 +24,10 @@ void pinfo_sum_and_wait(struct period_info *pinfo, long delta_ns)
 {
 	inc_period(pinfo, delta_ns);
 
-	/* for simplicity, ignoring possibilities of signal wakes */
-	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &pinfo->next_period, NULL);
+	/* signals (e.g., SIGINT stopping the run) must not wake us early */
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &pinfo->next_period,
+			       NULL) == EINTR)
+		;
 }
 
 void pinfo_sum_period_and_wait(struct period_info *pinfo)
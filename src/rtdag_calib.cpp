@@ -1,9 +1,22 @@
 #include "rtdag_calib.h"
+#include "logging.h"
+#include "newstuff/calibdb.h"
 #include "time_aux.h"
 
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
 
 #if RTDAG_USE_COMPILER_BARRIER == ON
 // It tells the compiler to not reorder instructions around it
@@ -86,38 +99,407 @@ int test_calibration(microseconds duration) {
     return test_calibration(duration, time_difference_unused);
 }
 
-int calibrate(microseconds duration) {
-    int ret;
-    struct timespec time_difference = {
-        .tv_sec = 1,
-        .tv_nsec = nanoseconds(microseconds(1)).count(),
+std::string rtgauss_type_name(rtgauss_type type) {
+    switch (type) {
+    case RTGAUSS_CPU:
+        return "cpu";
+#if RTDAG_OMP_SUPPORT == ON
+    case RTGAUSS_OMP:
+        return "omp";
+#endif
+    }
+    return "unknown";
+}
+
+// Student's t for a two-sided 95% confidence interval, by degrees of
+// freedom (1 to 30, then the normal approximation)
+static double student_t95(size_t dof) {
+    static constexpr double t[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+    return dof == 0 ? 0 : dof <= std::size(t) ? t[dof - 1] : 1.96;
+}
+
+static double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    const size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// Runs the busy loop once for the given duration with the given
+// estimate, returns the ticks per microsecond it actually obtained
+static double calibration_trial(microseconds duration, double estimate) {
+    const double ticks = estimate * duration.count();
+
+    COMPILER_BARRIER();
+
+    auto time_before = curtime();
+
+    COMPILER_BARRIER();
+
+    uint64_t retv = Count_Fractional_Ticks(ticks);
+    (void)(retv);
+
+    COMPILER_BARRIER();
+
+    auto time_after = curtime();
+
+    COMPILER_BARRIER();
+
+    const double elapsed_us = std::chrono::duration<double, std::micro>(
+                                  to_nanoseconds(time_after - time_before))
+                                  .count();
+    return ticks / std::max(elapsed_us, 1e-3);
+}
+
+struct trial_summary {
+    double median;
+    double mean;
+    double ci95;
+    size_t kept;
+};
+
+// Rejects the trials farther than 3 scaled MADs from the median (a
+// preemption or a frequency change), then summarizes the rest
+static trial_summary summarize_trials(const std::vector<double> &samples) {
+    const double m = median(samples);
+
+    std::vector<double> deviations;
+    for (double x : samples) {
+        deviations.push_back(std::abs(x - m));
+    }
+    const double limit = 3 * 1.4826 * median(deviations);
+
+    double sum = 0, sum_sq = 0;
+    size_t k = 0;
+    for (double x : samples) {
+        if (std::abs(x - m) <= limit) {
+            sum += x;
+            sum_sq += x * x;
+            ++k;
+        }
+    }
+
+    const double mean = sum / k;
+    const double var =
+        k > 1 ? std::max(0.0, (sum_sq - k * mean * mean) / (k - 1)) : 0;
+    return trial_summary{
+        .median = m,
+        .mean = mean,
+        .ci95 = student_t95(k - 1) * std::sqrt(var / k),
+        .kept = k,
+    };
+}
+
+// Pins the calibration to the given CPU and makes it SCHED_FIFO, so that
+// nothing preempts the trials (best effort without privileges)
+static int calibration_setup(int cpu) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    if (sched_setaffinity(0, sizeof(cpuset), &cpuset) < 0) {
+        LOG(ERROR, "could not pin the calibration to CPU %d: %s\n", cpu,
+            std::strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    struct sched_param sp = {
+        .sched_priority = sched_get_priority_max(SCHED_FIFO),
     };
+    if (sched_setscheduler(0, SCHED_FIFO, &sp) < 0) {
+        LOG(WARNING,
+            "could not switch to SCHED_FIFO: %s, trials may be preempted\n",
+            std::strerror(errno));
+    }
+
+    return EXIT_SUCCESS;
+}
+
+struct calib_outcome {
+    bool converged;
+    double ticks_per_us;
+    double ci95;
+
+    // Range of the frequency of the CPU, sampled after each trial (0 if
+    // unknown)
+    long min_khz;
+    long max_khz;
+};
+
+// Refines the estimate in rounds of trials on the given CPU (the current
+// one), printing each round if verbose
+static calib_outcome converge(const calib_options &opts, int cpu,
+                              double estimate, bool verbose) {
+    long min_khz = std::numeric_limits<long>::max();
+    long max_khz = 0;
+
+    // A first trial warms up caches and frequency and corrects the initial
+    // estimate, which may be far off
+    estimate = calibration_trial(opts.duration, estimate);
+
+    // Each round measures the current estimate: its error is how far the
+    // busy loop is from lasting the requested duration
+    constexpr int max_rounds = 10;
+    for (int round = 1; round <= max_rounds; ++round) {
+        std::vector<double> samples;
+        for (int i = 0; i < opts.trials; ++i) {
+            samples.push_back(calibration_trial(opts.duration, estimate));
+
+            const long khz = cpu_cur_freq_khz(cpu);
+            min_khz = std::min(min_khz, khz);
+            max_khz = std::max(max_khz, khz);
+        }
+
+        const trial_summary sum = summarize_trials(samples);
+        const double error = std::abs(estimate / sum.median - 1);
+
+        if (verbose) {
+            printf("Round %d: error %.3f%%, ticks_per_us %.3f +/- %.3f (95%% "
+                   "CI, %zu/%zu trials kept)\n",
+                   round, error * 100, sum.mean, sum.ci95, sum.kept,
+                   samples.size());
+        }
+
+        estimate = sum.mean;
+        if (error < opts.tolerance) {
+            return calib_outcome{true, estimate, sum.ci95, min_khz, max_khz};
+        }
+    }
 
-    ret = get_ticks_per_us(false);
-    if (ret) {
+    if (verbose) {
+        LOG(ERROR,
+            "calibration did not converge within %g%% in %d rounds, not "
+            "saved (pin the CPU frequency, or raise the duration or the "
+            "tolerance)\n",
+            opts.tolerance * 100, max_rounds);
+    }
+    return calib_outcome{false, estimate, 0, min_khz, max_khz};
+}
+
+// The key does not include the current frequency, which changes whenever
+// the CPU goes idle: warns if it changed also while the trials were running
+static void check_frequency(const calib_options &opts, int cpu,
+                            const calib_outcome &res) {
+    if (res.max_khz <= 0) {
+        return;
+    }
+
+    if (res.max_khz - res.min_khz > opts.tolerance * res.max_khz) {
+        LOG(WARNING,
+            "CPU %d ran at %ld-%ld kHz during the trials, pin its frequency "
+            "(performance or userspace governor) for accurate emulation\n",
+            cpu, res.min_khz, res.max_khz);
+    }
+}
+
+static int save_calibrations(
+    const calib_options &opts,
+    const std::vector<std::pair<calib_key, float>> &entries) {
+    CalibDb db;
+    for (const auto &[key, v] : entries) {
+        db.set(key, v);
+    }
+
+    if (!db.save()) {
+        LOG(ERROR, "could not save the calibration in %s\n",
+            db.get_path().c_str());
+        return EXIT_FAILURE;
+    }
+
+    const calib_key &key = entries.front().first;
+    std::cout << "Saved in " << db.get_path() << " (" << key.cpu_model << ", "
+              << key.governor << " governor at " << key.min_freq_khz << "-"
+              << key.max_freq_khz << " kHz, kernel " << key.kernel << "), "
+              << key.type << " tasks, matrix size " << opts.matrix_size
+              << std::endl;
+    return EXIT_SUCCESS;
+}
+
+// Lets the other threads of the CPU run while the caller only loads it,
+// best effort like calibration_setup
+static void calibration_background() {
+    struct sched_param sp = {
+        .sched_priority = 0,
+    };
+    if (sched_setscheduler(0, SCHED_OTHER, &sp) < 0) {
+        LOG(WARNING, "could not leave SCHED_FIFO: %s\n", std::strerror(errno));
+    }
+}
+
+// Calibrates every CPU rtdag may run on (or the given ones), first one at a
+// time with the others idle, then all together, so that each one runs with
+// the same kernel on all the others, sharing caches and memory bandwidth
+static int calibrate_all(const calib_options &opts, double estimate) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) {
+        LOG(ERROR, "sched_getaffinity() failed: %s\n", std::strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    std::vector<int> cpus = opts.cpus;
+    for (int cpu : cpus) {
+        if (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)) {
+            LOG(ERROR, "rtdag may not run on CPU %d\n", cpu);
+            return EXIT_FAILURE;
+        }
+    }
+    if (cpus.empty()) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+
+    const size_t n = cpus.size();
+    std::cout << "About to calibrate " << n << " CPUs, isolated and loaded, "
+              << opts.trials << " trials of (roughly) " << opts.duration
+              << " per round ..." << std::endl;
+
+    // With RT throttling disabled, SCHED_FIFO busy loops on every CPU would
+    // starve the kernel threads (kworkers, RCU) of the whole system: unless
+    // some CPU is left out already, the first one is calibrated isolated
+    // only and handles the housekeeping during the loaded phase
+    const bool housekeeping = n > 1 && int(n) == CPU_COUNT(&allowed);
+    if (housekeeping) {
+        std::cout << "CPU " << cpus.front()
+                  << " is left out of the loaded phase for housekeeping "
+                     "(choose the CPUs with -L)"
+                  << std::endl;
+    }
+    const size_t first_loaded = housekeeping ? 1 : 0;
+
+    // Each thread pins itself first, so its matrices are local to its CPU
+    const auto on_cpu = [&](int cpu, auto body) {
+        if (calibration_setup(cpu)) {
+            exit(EXIT_FAILURE);
+        }
+        rtgauss_init(opts.matrix_size, opts.type, opts.omp_target);
+        body();
+        rtgauss_exit();
+    };
+
+    std::vector<calib_outcome> isolated(n);
+    for (size_t i = 0; i < n; ++i) {
+        std::thread th(on_cpu, cpus[i], [&, i] {
+            isolated[i] = converge(opts, cpus[i], estimate, false);
+        });
+        th.join();
+    }
+
+    // Threads that converged keep running trials until the last one did,
+    // so that the load lasts for the whole calibration, as SCHED_OTHER so
+    // that the kernel threads of their CPUs get to run
+    std::vector<calib_outcome> loaded(n);
+    std::barrier start(n - first_loaded);
+    std::atomic<size_t> running = n - first_loaded;
+    std::vector<std::thread> threads;
+    for (size_t i = first_loaded; i < n; ++i) {
+        threads.emplace_back(on_cpu, cpus[i], [&, i] {
+            start.arrive_and_wait();
+            loaded[i] =
+                converge(opts, cpus[i], isolated[i].ticks_per_us, false);
+            running.fetch_sub(1);
+            calibration_background();
+            while (running.load() > 0) {
+                calibration_trial(opts.duration, loaded[i].ticks_per_us);
+            }
+        });
+    }
+    for (auto &th : threads) {
+        th.join();
+    }
+
+    printf("%-5s %-22s %-22s %s\n", "CPU", "ISOLATED (95% CI)",
+           "LOADED (95% CI)", "SLOWDOWN");
+
+    const auto cell = [](const calib_outcome &c) {
+        char buf[32] = "-";
+        if (c.converged) {
+            snprintf(buf, sizeof(buf), "%.3f +/- %.3f", c.ticks_per_us,
+                     c.ci95);
+        }
+        return std::string(buf);
+    };
+
+    const std::string type = rtgauss_type_name(opts.type);
+    std::vector<std::pair<calib_key, float>> entries;
+    bool all_converged = true;
+    for (size_t i = 0; i < n; ++i) {
+        const calib_outcome &iso = isolated[i];
+        const calib_outcome &ld = loaded[i];
+        printf("%-5d %-22s %-22s ", cpus[i], cell(iso).c_str(),
+               cell(ld).c_str());
+        if (iso.converged && ld.converged) {
+            printf("%.3f\n", iso.ticks_per_us / ld.ticks_per_us);
+        } else {
+            printf("-\n");
+        }
+
+        if (iso.converged) {
+            entries.emplace_back(
+                calib_key_of(cpus[i], type, opts.matrix_size, "isolated"),
+                iso.ticks_per_us);
+        }
+        if (ld.converged) {
+            entries.emplace_back(
+                calib_key_of(cpus[i], type, opts.matrix_size, "loaded"),
+                ld.ticks_per_us);
+        }
+        all_converged = all_converged && iso.converged &&
+                        (ld.converged || i < first_loaded);
+        check_frequency(opts, cpus[i], iso);
+        check_frequency(opts, cpus[i], ld);
+    }
+
+    if (!all_converged) {
+        LOG(ERROR,
+            "some calibrations did not converge within %g%%, not saved (pin "
+            "the CPU frequencies, or raise the duration or the tolerance)\n",
+            opts.tolerance * 100);
+    }
+
+    if (!entries.empty() && save_calibrations(opts, entries)) {
+        return EXIT_FAILURE;
+    }
+    return all_converged ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int calibrate(const calib_options &opts) {
+    if (get_ticks_per_us(false)) {
         // Set a value that is not so small in ticks_per_us
         ticks_per_us = 10;
     }
 
-    std::cout << "About to calibrate for (roughly) " << duration
-              << " micros ..." << std::endl;
+    if (opts.all_cpus) {
+        return calibrate_all(opts, ticks_per_us);
+    }
 
-    // Will never return an error
-    test_calibration(duration, time_difference);
-    // fprintf(stderr, "DEBUG: %llu %llu %llu %llu\n", duration_us,
-    // time_difference, ticks_per_us, duration_us * ticks_per_us);
+    const int cpu = opts.cpu >= 0 ? opts.cpu : sched_getcpu();
+    if (calibration_setup(cpu)) {
+        return EXIT_FAILURE;
+    }
 
-    using ticks_type = decltype(ticks_per_us);
+    std::cout << "About to calibrate on CPU " << cpu << ", " << opts.trials
+              << " trials of (roughly) " << opts.duration
+              << " per round ..." << std::endl;
 
-    double duration_d = duration.count();
-    double time_difference_d = std::chrono::duration<double, std::micro>(
-                                   to_nanoseconds(time_difference))
-                                   .count();
+    const calib_outcome res = converge(opts, cpu, ticks_per_us, true);
+    if (!res.converged) {
+        return EXIT_FAILURE;
+    }
+    check_frequency(opts, cpu, res);
 
-    ticks_per_us = ticks_type((duration_d * ticks_per_us) / time_difference_d);
+    using ticks_type = decltype(ticks_per_us);
+    ticks_per_us = ticks_type(res.ticks_per_us);
 
     std::cout << "Calibration successful, use: 'export TICKS_PER_US="
               << ticks_per_us << "'" << std::endl;
 
-    return EXIT_SUCCESS;
+    return save_calibrations(
+        opts, {{calib_key_of(cpu, rtgauss_type_name(opts.type),
+                             opts.matrix_size, "isolated"),
+                ticks_per_us}});
 }
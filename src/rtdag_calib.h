@@ -1,7 +1,11 @@
 #ifndef RTDAG_CALIB_H
 #define RTDAG_CALIB_H
 
+#include <string>
+#include <vector>
+
 #include "newstuff/integers.h"
+#include "rtgauss.h"
 #include "time_aux.h"
 
 int get_ticks_per_us(bool required);
@@ -12,6 +16,32 @@ int test_calibration(microseconds duration, u64 &time_difference);
 
 int test_calibration(microseconds duration);
 
-int calibrate(microseconds duration);
+struct calib_options {
+    // Of each trial
+    microseconds duration;
+    rtgauss_type type;
+    int matrix_size;
+
+    // Where to calibrate (the current CPU if negative), or all the CPUs
+    // rtdag may run on, isolated and loaded (only the given ones if any)
+    int cpu = -1;
+    bool all_cpus = false;
+    std::vector<int> cpus;
+
+    // Of omp tasks, for the threads of the calibration of all CPUs
+    int omp_target = 0;
+
+    // Per round, until the error of the estimate is below the (relative)
+    // tolerance
+    int trials = 15;
+    double tolerance = 0.01;
+};
+
+// Calibrates ticks_per_us on a CPU, in rounds of trials without outliers,
+// and saves the result in the calibration database
+int calibrate(const calib_options &opts);
+
+// The name of the task type, as in tasks_type
+std::string rtgauss_type_name(rtgauss_type type);
 
 #endif // RTDAG_CALIB_H
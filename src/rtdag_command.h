@@ -4,8 +4,11 @@
 #include "input/input.h"
 #include <getopt.h>
 
+#include <algorithm>
 #include <cassert>
 #include <optional>
+#include <sstream>
+#include <vector>
 
 #include "rtgauss.h"
 
@@ -42,6 +45,16 @@ The following options are used in combination with -c or -t, ignored otherwise:
                                 tests
     %s
 
+The following options are used in combination with -c, ignored otherwise:
+    -P CPU[=current]            The CPU to calibrate (rtdag pins itself and
+                                runs as SCHED_FIFO)
+    -A                          Calibrate all the CPUs rtdag may run on, each
+                                isolated and then all together (loaded)
+    -L CPUS                     Like -A, on the given CPUs only, as a list
+                                like 2-5,8 (e.g., those of tasks_affinity)
+    -N TRIALS[=15]              The number of trials of USEC each per round
+    -E TOLERANCE[=1]            The error (in %%) below which rounds stop
+
 
 Accepted task types: %s
 
@@ -77,6 +90,11 @@ struct opts {
     rtgauss_type rtg_type = RTGAUSS_CPU;
     int rtg_target = 0;
     int rtg_msize = 4;
+    int calib_cpu = -1;
+    bool calib_all_cpus = false;
+    std::vector<int> calib_cpus;
+    int calib_trials = 15;
+    double calib_tolerance = 0.01;
     int exit_code = EXIT_SUCCESS;
 };
 
@@ -107,6 +125,40 @@ std::optional<rtgauss_type> parse_argument_from_string(const char *str) {
     return std::nullopt;
 }
 
+// A list of CPUs or ranges, like "2-5,8"
+template <>
+std::optional<std::vector<int>> parse_argument_from_string(const char *str) {
+    std::vector<int> cpus;
+    std::istringstream mstream(str);
+
+    std::string range;
+    while (std::getline(mstream, range, ',')) {
+        std::istringstream rstream(range);
+        int first, last;
+        char dash;
+        if (!(rstream >> first) || first < 0) {
+            return std::nullopt;
+        }
+        if (!(rstream >> dash)) {
+            last = first;
+        } else if (dash != '-' || !(rstream >> last) || last < first) {
+            return std::nullopt;
+        }
+
+        for (int cpu = first; cpu <= last; ++cpu) {
+            if (std::find(cpus.begin(), cpus.end(), cpu) == cpus.end()) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+
+    if (cpus.empty()) {
+        return std::nullopt;
+    }
+    std::sort(cpus.begin(), cpus.end());
+    return cpus;
+}
+
 opts parse_args(int argc, char *argv[]) {
     opts program_options;
     char the_option = ' ';
@@ -119,7 +171,7 @@ opts parse_args(int argc, char *argv[]) {
             {0, 0, 0, 0}};
 
         int c = getopt_long(argc, argv,
-                            "hc:t:C:M:"
+                            "hc:t:C:M:P:AL:N:E:"
 #if RTDAG_OMP_SUPPORT == ON
                             "T:"
 #endif
@@ -174,6 +226,46 @@ opts parse_args(int argc, char *argv[]) {
             }
             break;
         }
+        case 'P': {
+            auto cpu = parse_argument_from_string<int>(optarg);
+            if (!cpu || *cpu < 0) {
+                goto arg_error;
+            }
+
+            program_options.calib_cpu = *cpu;
+            break;
+        }
+        case 'A':
+            program_options.calib_all_cpus = true;
+            break;
+        case 'L': {
+            auto cpus = parse_argument_from_string<std::vector<int>>(optarg);
+            if (!cpus) {
+                goto arg_error;
+            }
+
+            program_options.calib_all_cpus = true;
+            program_options.calib_cpus = *cpus;
+            break;
+        }
+        case 'N': {
+            auto trials = parse_argument_from_string<int>(optarg);
+            if (!trials || *trials < 3) {
+                goto arg_error;
+            }
+
+            program_options.calib_trials = *trials;
+            break;
+        }
+        case 'E': {
+            auto tolerance = parse_argument_from_string<double>(optarg);
+            if (!tolerance || *tolerance <= 0) {
+                goto arg_error;
+            }
+
+            program_options.calib_tolerance = *tolerance / 100;
+            break;
+        }
         case 'T': {
             auto target = parse_argument_from_string<int>(optarg);
             if (!target) {
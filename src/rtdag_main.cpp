@@ -23,7 +23,17 @@ int main(int argc, char *argv[]) {
         std::ofstream nullf("/dev/null");
         auto retv = waste_calibrate();
         nullf << retv;
-        return calibrate(program_options.duration);
+        return calibrate(calib_options{
+            .duration = program_options.duration,
+            .type = program_options.rtg_type,
+            .matrix_size = program_options.rtg_msize,
+            .cpu = program_options.calib_cpu,
+            .all_cpus = program_options.calib_all_cpus,
+            .cpus = program_options.calib_cpus,
+            .omp_target = program_options.rtg_target,
+            .trials = program_options.calib_trials,
+            .tolerance = program_options.calib_tolerance,
+        });
     }
 
     case command_action::TEST: {
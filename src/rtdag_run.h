@@ -6,6 +6,8 @@
 #include "input/input.h"
 #include "newstuff/taskset.h"
 
+#include <atomic>
+#include <csignal>
 #include <cstring>
 #include <sys/stat.h>
 
@@ -22,21 +24,26 @@
 // unsigned long dag_start_time;
 std::vector<int> pid_list;
 
-// void exit_all([[maybe_unused]] int sigid) {
-// #if TASK_IMPL == TASK_IMPL_THREAD
-//     printf("Killing all threads\n");
-//     // TODO: how to kill the threads without access to the thread list ?
-// #else
-//     printf("Killing all tasks\n");
-//     unsigned i, ret;
-//     for (i = 0; i < pid_list.size(); ++i) {
-//         ret = kill(pid_list[i], SIGKILL);
-//         assert(ret == 0);
-//     }
-// #endif
-//     printf("Exting\n");
-//     exit(0);
-// }
+// Set on SIGINT or SIGTERM: the originator stops releasing new instances,
+// the ones in flight drain and the results are saved as usual. The flag is
+// in the arena, so the handler works in the tasks too when they are
+// processes (they inherit it). A second signal kills rtdag.
+std::atomic<bool> *stop_requested = nullptr;
+
+void stop_all([[maybe_unused]] int sigid) {
+    stop_requested->store(true, std::memory_order_relaxed);
+}
+
+static void install_stop_handler(std::atomic<bool> &flag) {
+    stop_requested = &flag;
+
+    struct sigaction sa = {};
+    sa.sa_handler = stop_all;
+    sa.sa_flags = SA_RESTART | SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+}
 
 int get_ticks_per_us(bool required);
 
@@ -47,10 +54,11 @@ int run_dag(const std::string &in_fname) {
     unsigned seed = 123456;
     std::cout << "SEED: " << seed << std::endl;
 
-    // Check whether the environment contains the TICKS_PER_US variable
-    int ret = get_ticks_per_us(true);
-    if (ret) {
-        return ret;
+    // The TICKS_PER_US variable is needed only by the tasks that are not
+    // calibrated otherwise (see the calibration database), which fail if
+    // it is not set
+    if (getenv("TICKS_PER_US")) {
+        get_ticks_per_us(false);
     }
 
     // read the dag configuration from the selected type of input
@@ -75,11 +83,18 @@ int run_dag(const std::string &in_fname) {
         }
     }
 
+    install_stop_handler(task_set.dag.control.stop_requested);
+
     // pass pid_list such that tasks can be killed with CTRL+C
     task_set.launch(pid_list, seed);
     // "" is used only to avoid variadic macro warning
     LOG(INFO, "[main] all tasks were finished%s...\n", " ");
 
+    task_set.save_results();
+    task_set.save_timeline();
+    task_set.print_summary(std::cout);
+    task_set.save_blame_report(std::cout);
+
     return 0;
 }
 #endif // RTDAG_RUN_H
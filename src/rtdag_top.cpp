@@ -0,0 +1,174 @@
+// rtdag-top: shows the live counters of all the rtdag instances running on
+// the machine (those with live_metrics enabled), refreshed periodically.
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "newstuff/live.h"
+
+static void usage(const char *argv0) {
+    std::fprintf(stderr,
+                 "Usage: %s [-d seconds] [-n iterations]\n"
+                 "\n"
+                 "  -d  refresh period, 1 second by default\n"
+                 "  -n  number of refreshes, 0 (default) to run forever\n",
+                 argv0);
+}
+
+// Read-only mapping of the segment of an instance
+class LiveSegment {
+    void *base = MAP_FAILED;
+    size_t size = 0;
+
+public:
+    explicit LiveSegment(const std::string &name) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            return;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(live_header)) {
+            size = st.st_size;
+            base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+    }
+
+    ~LiveSegment() {
+        if (base != MAP_FAILED) {
+            munmap(base, size);
+        }
+    }
+
+    LiveSegment(const LiveSegment &) = delete;
+    LiveSegment &operator=(const LiveSegment &) = delete;
+
+    // Whether the segment is complete and of a known version
+    bool valid() const {
+        if (base == MAP_FAILED) {
+            return false;
+        }
+
+        const live_header &h = header();
+        return std::memcmp(h.magic, live_magic, sizeof(live_magic)) == 0 &&
+               h.version == live_version &&
+               size >= LiveMetrics::segment_size(h.ntasks);
+    }
+
+    const live_header &header() const {
+        return *static_cast<const live_header *>(base);
+    }
+
+    const live_task &task(u32 i) const {
+        return reinterpret_cast<const live_task *>(&header() + 1)[i];
+    }
+};
+
+static double us(u64 ns) {
+    return ns / 1000.;
+}
+
+static bool alive(pid_t pid) {
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+static void show(const LiveSegment &seg) {
+    const live_header &h = seg.header();
+    const auto dag = h.dag.read().value_or(live_dag_stats{});
+
+    // Streaming runs go on until stopped
+    char total[24] = "-";
+    if (h.num_activations > 0) {
+        std::snprintf(total, sizeof(total), "%ld", h.num_activations);
+    }
+
+    std::printf("%-8ld %-20s %8lu/%-8s %8lu %12.3f %12.3f%s\n", h.pid,
+                h.dag_name, dag.activations, total, dag.misses,
+                us(dag.last_response_ns), us(dag.max_response_ns),
+                alive(h.pid) ? "" : "  (dead)");
+
+    for (u32 i = 0; i < h.ntasks; ++i) {
+        const live_task &t = seg.task(i);
+        const auto stats = t.stats.read().value_or(live_task_stats{});
+        std::printf("  %-16s %4d %10lu %14.3f %14.3f %8lu %14.3f\n", t.name,
+                    t.cpu, stats.jobs, us(stats.max_exec_ns),
+                    us(stats.push_ns), stats.deadline_misses,
+                    stats.max_lateness_ns / 1000.);
+    }
+}
+
+static void refresh() {
+    std::vector<std::string> names;
+    for (const auto &entry : std::filesystem::directory_iterator("/dev/shm")) {
+        const std::string name = entry.path().filename();
+        if (name.starts_with(live_prefix)) {
+            names.push_back("/" + name);
+        }
+    }
+
+    // Clear the screen
+    std::printf("\033[H\033[2J");
+    std::printf("rtdag-top - %lu instances\n\n", names.size());
+    std::printf("%-8s %-20s %17s %8s %12s %12s\n", "PID", "DAG",
+                "ACTIVATIONS", "MISSES", "LAST(us)", "MAX(us)");
+    std::printf("  %-16s %4s %10s %14s %14s %8s %14s\n", "TASK", "CPU",
+                "JOBS", "MAX_EXEC(us)", "PUSH(us)", "MISSES", "MAX_LATE(us)");
+    std::printf("\n");
+
+    for (const auto &name : names) {
+        LiveSegment seg(name);
+        if (seg.valid()) {
+            show(seg);
+        }
+    }
+
+    std::fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    double period = 1;
+    long iterations = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:n:h")) != -1) {
+        switch (opt) {
+        case 'd':
+            period = std::atof(optarg);
+            break;
+        case 'n':
+            iterations = std::atol(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (period <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (long i = 0; iterations == 0 || i < iterations; ++i) {
+        if (i > 0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(period));
+        }
+        refresh();
+    }
+
+    return EXIT_SUCCESS;
+}
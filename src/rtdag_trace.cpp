@@ -0,0 +1,173 @@
+// rtdag-trace: exports the binary trace of a run (results_format: binary)
+// as CSV columns, ready to be loaded by pandas, R, DuckDB, etc.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "newstuff/trace.h"
+
+static void usage(const char *argv0) {
+    std::fprintf(stderr,
+                 "Usage: %s <trace> info|responses|jobs\n"
+                 "\n"
+                 "  info       print the DAG and task metadata\n"
+                 "  responses  CSV of the DAG response times (us)\n"
+                 "  jobs       CSV of the job timestamps of all tasks (ns)\n",
+                 argv0);
+}
+
+[[noreturn]] static void fail(const char *fname, const char *what) {
+    std::fprintf(stderr, "ERROR: %s: %s\n", fname, what);
+    std::exit(EXIT_FAILURE);
+}
+
+// Reads the file, checking that every structure fits in it
+class TraceReader {
+    const char *fname;
+    std::vector<char> data;
+    size_t offset = 0;
+
+public:
+    explicit TraceReader(const char *fname) : fname(fname) {
+        std::ifstream f(fname, std::ios::binary);
+        if (!f) {
+            fail(fname, "cannot open file");
+        }
+        data.assign(std::istreambuf_iterator<char>(f),
+                    std::istreambuf_iterator<char>());
+    }
+
+    // Reads a structure stored in size bytes, without moving on: fields
+    // missing in older versions are left zeroed
+    template <class T>
+    T peek(size_t size) const {
+        if (offset + size > data.size()) {
+            fail(fname, "truncated trace");
+        }
+
+        T value = {};
+        std::memcpy(&value, data.data() + offset, std::min(size, sizeof(T)));
+        return value;
+    }
+
+    // Like peek, moving past the structure (and past the fields added by
+    // newer versions)
+    template <class T>
+    T read(size_t size) {
+        T value = peek<T>(size);
+        offset += size;
+        return value;
+    }
+};
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char *fname = argv[1];
+    const std::string what = argv[2];
+    if (what != "info" && what != "responses" && what != "jobs") {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    TraceReader in(fname);
+
+    // The size of the header is right after magic and version
+    const auto prefix = in.peek<trace_header>(
+        offsetof(trace_header, header_size) + sizeof(u32));
+    if (std::memcmp(prefix.magic, trace_magic, sizeof(trace_magic)) != 0) {
+        fail(fname, "not an rtdag trace");
+    }
+    if (prefix.version > trace_version) {
+        fail(fname, "trace version not supported, update rtdag-trace");
+    }
+
+    const auto header = in.read<trace_header>(prefix.header_size);
+
+    std::vector<trace_task> tasks;
+    for (u32 i = 0; i < header.ntasks; ++i) {
+        tasks.push_back(in.read<trace_task>(header.task_size));
+    }
+
+    if (what == "info") {
+        std::printf("dag:          %s\n", header.dag_name);
+        std::printf("version:      %u\n", header.version);
+        std::printf("period:       %ld ns\n", header.period_ns);
+        std::printf("deadline:     %ld ns\n", header.deadline_ns);
+        std::printf("activations:  %ld (+%ld warm-up)", header.num_activations,
+                    header.warmup_activations);
+        if (header.first_activation > 0) {
+            std::printf(", from %ld", header.first_activation);
+        }
+        std::printf("\n");
+        std::printf("max_inflight: %u\n", header.max_inflight);
+        std::printf("counters:     %s\n", header.sample_size ? "yes" : "no");
+        std::printf("tasks:\n");
+        for (const auto &t : tasks) {
+            const char *counters = "";
+            if (header.sample_size) {
+                counters = t.flags & trace_task_hw_counters
+                               ? ", hardware counters"
+                               : ", software counters only";
+            }
+            std::printf("  %-16s cpu %3d, %ld jobs%s\n", t.name, t.cpu,
+                        t.njobs, counters);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (what == "responses") {
+        std::printf("activation,response_us\n");
+        for (s64 i = 0; i < header.num_activations; ++i) {
+            std::printf("%ld,%ld\n", header.first_activation + i,
+                        in.read<s64>(sizeof(s64)));
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // Skip the response times
+    for (s64 i = 0; i < header.num_activations; ++i) {
+        in.read<s64>(sizeof(s64));
+    }
+
+    std::printf("task,iter,release_ns,wakeup_ns,start_ns,end_ns,pushed_ns,"
+                "cpu");
+    if (header.sample_size) {
+        for (const char *counter : perf_counter_names) {
+            std::printf(",%s", counter);
+        }
+    }
+    std::printf("\n");
+
+    for (const auto &t : tasks) {
+        // The records of each task are followed by its samples
+        std::vector<job_record> records;
+        for (s64 i = 0; i < t.njobs; ++i) {
+            records.push_back(in.read<job_record>(header.record_size));
+        }
+
+        for (const auto &r : records) {
+            std::printf("%s,%ld,%ld,%ld,%ld,%ld,%ld,%d", t.name, r.iter,
+                        r.release, r.wakeup, r.start, r.end, r.pushed, r.cpu);
+            if (header.sample_size) {
+                const auto c = in.read<perf_sample>(header.sample_size);
+                for (u64 v : c.count) {
+                    std::printf(",%lu", v);
+                }
+            }
+            std::printf("\n");
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -11,7 +11,7 @@
 #include <omp.h>
 #endif
 
-#include <vector>
+#include <span>
 
 #include "rtgauss.h"
 #include "time_aux.h"
@@ -123,36 +123,32 @@ static void gauss_fill_eye_matrix(double *out, const int size) {
 // RTGAUSS WASTE TIME
 //----------------------------------------------------------
 
-// Pack thread-allocated data together
+// Pack thread-allocated data together, in a single mapping that is
+// prefaulted on construction
 struct task_matrix_data {
     const int size;
     const enum rtgauss_type type;
-    std::vector<double> A;
-    std::vector<double> B;
-    std::vector<double> C;
+    PageBuffer memory;
+    std::span<double> A;
+    std::span<double> B;
+    std::span<double> C;
 
-    explicit task_matrix_data(const int size, const rtgauss_type type) :
+    explicit task_matrix_data(const int size, const rtgauss_type type,
+                              huge_pages backing) :
         size(size),
         type(type),
-        A(size * size),
-        B(size * size),
-        C(size * size) {}
+        memory(3 * size * size * sizeof(double), backing),
+        A(memory.as<double>(0, size * size)),
+        B(memory.as<double>(size * size, size * size)),
+        C(memory.as<double>(2 * size * size, size * size)) {}
 };
 
 static __thread int omp_dev = -1;
 static __thread task_matrix_data *tdata = nullptr;
 
-// Must be called by each cpu and omp thread!
-void rtgauss_init(int size, rtgauss_type type, int omp_target_dev) {
-    // Construct the data with the right size
-    tdata = new task_matrix_data(size, type);
-    omp_dev = omp_target_dev;
-
-    // TODO: fill with different matrices perhaps?
-    gauss_fill_eye_matrix(tdata->A.data(), tdata->size);
-    gauss_fill_eye_matrix(tdata->B.data(), tdata->size);
-    gauss_fill_eye_matrix(tdata->C.data(), tdata->size);
-}
+// Resolved by rtgauss_init, like the number of filler units per tick
+static __thread rtgauss_kernel_fn kernel = nullptr;
+static __thread double fine_per_tick = 0;
 
 static uint64_t rtgauss_waste_time_cpu(uint64_t in) {
     // Operates on thread-private data of the right size!
@@ -172,16 +168,90 @@ static uint64_t rtgauss_waste_time_omp(uint64_t in) {
 }
 #endif
 
-uint64_t rtgauss_waste_time(uint64_t in) {
-    switch (tdata->type) {
+// One filler unit is a multiply-add of a dependent chain, a few cycles that
+// the compiler can neither vectorize nor fold
+static uint64_t rtgauss_waste_fine(uint64_t in, uint64_t units) {
+    for (uint64_t i = 0; i < units; ++i) {
+        in = in * 6364136223846793005ULL + 1442695040888963407ULL;
+        asm volatile("" : "+r"(in));
+    }
+    return in;
+}
+
+// Nanoseconds per call of fn(n), doubling n until a run lasts long enough
+// to be timed accurately
+template <class Fn>
+static double ns_per_unit(Fn fn) {
+    constexpr double min_ns = 200000;
+    for (uint64_t n = 1;; n *= 2) {
+        const struct timespec before = curtime();
+        fn(n);
+        const double ns = to_nanoseconds(curtime() - before).count();
+        if (ns >= min_ns) {
+            return ns / n;
+        }
+    }
+}
+
+// Must be called by each cpu and omp thread!
+void rtgauss_init(int size, rtgauss_type type, int omp_target_dev) {
+    rtgauss_init(size, type, omp_target_dev, huge_pages::NONE);
+}
+
+void rtgauss_init(int size, rtgauss_type type, int omp_target_dev,
+                  huge_pages backing) {
+    switch (type) {
     case RTGAUSS_CPU:
-        return rtgauss_waste_time_cpu(in);
+        kernel = rtgauss_waste_time_cpu;
+        break;
 #if RTDAG_OMP_SUPPORT == ON
     case RTGAUSS_OMP:
-        return rtgauss_waste_time_omp(in);
+        kernel = rtgauss_waste_time_omp;
+        break;
 #endif
     default:
-        fprintf(stderr, "ERROR: Invalid RTGAUSS type %d!\n", tdata->type);
+        fprintf(stderr, "ERROR: Invalid RTGAUSS type %d!\n", type);
         exit(EXIT_FAILURE);
     }
+
+    // Construct the data with the right size
+    tdata = new task_matrix_data(size, type, backing);
+    omp_dev = omp_target_dev;
+
+    // TODO: fill with different matrices perhaps?
+    gauss_fill_eye_matrix(tdata->A.data(), tdata->size);
+    gauss_fill_eye_matrix(tdata->B.data(), tdata->size);
+    gauss_fill_eye_matrix(tdata->C.data(), tdata->size);
+
+    // The remainder of a duration is a fraction of a tick, wasted with the
+    // filler: how many of its units make a tick depends on the kernel and
+    // on the size of the matrices
+    uint64_t sink = 0;
+    const double tick_ns = ns_per_unit([&sink](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            sink = kernel(sink);
+        }
+    });
+    const double unit_ns = ns_per_unit(
+        [&sink](uint64_t n) { sink = rtgauss_waste_fine(sink, n); });
+    fine_per_tick = tick_ns / unit_ns;
+    asm volatile("" : : "r"(sink));
+}
+
+void rtgauss_exit(void) {
+    delete tdata;
+    tdata = nullptr;
+    kernel = nullptr;
+}
+
+rtgauss_kernel_fn rtgauss_kernel(void) {
+    return kernel;
+}
+
+uint64_t rtgauss_waste_time(uint64_t in) {
+    return kernel(in);
+}
+
+uint64_t rtgauss_waste_fraction(uint64_t in, double fraction) {
+    return rtgauss_waste_fine(in, uint64_t(fraction * fine_per_tick));
 }
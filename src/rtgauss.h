@@ -17,10 +17,28 @@ enum rtgauss_type {
 // Must be called by each cpu and omp thread!
 extern void rtgauss_init(int size, enum rtgauss_type type, int omp_target_dev);
 
+// Frees the matrices allocated by rtgauss_init for the calling thread
+extern void rtgauss_exit(void);
+
 extern uint64_t rtgauss_waste_time(uint64_t in);
 
+// The kernel of the type given to rtgauss_init, one tick per call: resolve
+// it once and call it in the loop
+typedef uint64_t (*rtgauss_kernel_fn)(uint64_t in);
+extern rtgauss_kernel_fn rtgauss_kernel(void);
+
+// Wastes the given fraction of a tick with a fine-grained filler loop,
+// calibrated against the kernel by rtgauss_init
+extern uint64_t rtgauss_waste_fraction(uint64_t in, double fraction);
+
 #ifdef __cplusplus
 }
+
+#include "newstuff/hugepages.h"
+
+// Like rtgauss_init, with the matrices backed by the given pages
+extern void rtgauss_init(int size, enum rtgauss_type type, int omp_target_dev,
+                         huge_pages backing);
 #endif
 
 #endif // RTGAUSS_H
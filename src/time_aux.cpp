@@ -35,14 +35,22 @@ uint64_t Count_Time(uint64_t duration_usec) {
 float ticks_per_us = 0;
 
 uint64_t Count_Time_Ticks(microseconds duration, float ticks_per_us) {
-    uint64_t ticks = ticks_per_us * duration.count();
-    return Count_Ticks(ticks);
+    return Count_Fractional_Ticks(double(ticks_per_us) * duration.count());
 }
 
 uint64_t Count_Ticks(uint64_t sheeps) {
+    // The kernel is resolved once, not at every tick
+    const rtgauss_kernel_fn waste_time = rtgauss_kernel();
+
     uint64_t temp = 0;
     for (uint64_t counted = 0; counted < sheeps; ++counted) {
-        temp += rtgauss_waste_time(temp);
+        temp += waste_time(temp);
     }
     return temp;
 }
+
+uint64_t Count_Fractional_Ticks(double ticks) {
+    const uint64_t whole = ticks;
+    const uint64_t temp = Count_Ticks(whole);
+    return rtgauss_waste_fraction(temp, ticks - whole);
+}
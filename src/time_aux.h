@@ -56,6 +56,11 @@ extern "C" {
 // source of time_aux.c.
 extern uint64_t Count_Ticks(uint64_t ticks) ATTRIBUTE_DISABLE_OPTIMIZATIONS;
 
+// Like Count_Ticks, plus the fraction of a tick left, wasted with a
+// fine-grained filler loop instead of being truncated
+extern uint64_t Count_Fractional_Ticks(double ticks)
+    ATTRIBUTE_DISABLE_OPTIMIZATIONS;
+
 // Execute for an amount of ticks derived from the time span indicated by
 // usec and ticks_per_us (use `ticks_per_us` global variable if you don't
 // want special time accounting)